@@ -53,3 +53,38 @@ enum PlnAsgnType {
 	ASGN_MOVE,
 	ASGN_COPY_REF
 };
+
+// Operation of vectorized loop.
+enum PlnVecOpe {
+	VOP_LOAD,	/// Load array items.
+	VOP_SCALAR,	/// Loop invariant value.
+	VOP_ADD,
+	VOP_SUB,
+	VOP_MUL,
+	VOP_DIV,
+	VOP_STORE,	/// Store to array items.
+	VOP_SUM	/// Add to the total.
+};
+
+// Contracted multiply-add. c: accumulator
+enum PlnFMAType {
+	FMA_ADD,	/// c + a*b
+	FMA_NADD,	/// c - a*b
+	FMA_SUB	/// a*b - c
+};
+
+// Well-known C functions processed inline.
+enum PlnIntrinsicType {
+	IN_SQRT,
+	IN_FABS,
+	IN_FMIN,
+	IN_FMAX,
+	IN_FLOOR,	/// Requires round instruction.
+	IN_CEIL,	/// Requires round instruction.
+	IN_POPCOUNT,
+	IN_CLZ,	/// Count leading zeros.
+	IN_CTZ,	/// Count trailing zeros.
+	IN_BSWAP,
+	IN_ROTL,
+	IN_ROTR
+};
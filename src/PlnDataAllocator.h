@@ -55,7 +55,8 @@ public:
 
 	void allocDp(PlnDataPlace *Dp, bool proceed_step = true);
 	void releaseDp(PlnDataPlace* dp);
-	virtual void funcCalled(vector<PlnDataPlace*>& args, int func_type, bool never_return) = 0;
+	// destroy_regs: registers the function destroys. NULL means all of caller saved registers.
+	virtual void funcCalled(vector<PlnDataPlace*>& args, int func_type, bool never_return, const vector<int>* destroy_regs = NULL) = 0;
 	// need to pass allocated dp with data_type and size.
 	virtual void setArgDps(int func_type, vector<PlnDataPlace*> &arg_dps, bool is_callee) = 0;
 	virtual void setRetValDps(int func_type, vector<PlnDataPlace*> &retval_dps, bool is_callee) = 0;
@@ -125,7 +126,7 @@ class PlnDataPlace
 {
 public:
 	char type;
-	char size;
+	int32_t size;	// stack object can be larger than 127 bytes.
 	char data_type;
 	char status;
 
@@ -133,6 +134,7 @@ public:
 	bool load_address;
 	bool need_address;
 	bool do_clear_src;
+	char struct_parts;	// Number of arguments of the struct passed by value. Set to the first.
 
 	int32_t alloc_step;
 	int32_t release_step;
@@ -33,6 +33,14 @@ public:
 	~PlnGenEntity() { delete ope; }
 };
 
+// Postfix code of vectorized loop body.
+// id: index of the arguments.
+class PlnVecCode {
+public:
+	int ope;
+	int id;
+};
+
 class PlnGenerator
 {
 protected:
@@ -55,6 +63,9 @@ public:
 	virtual void genEntryFunc() = 0;
 	virtual void genLocalVarArea(int size)=0;
 	virtual void genEndFunc() = 0;
+	// Get registers destroyed by the generated function. Return false if unknown.
+	virtual bool getDestroyRegs(const string& func_name, vector<int>& regids) = 0;
+	virtual void genPoolAllocator(bool with_stats) = 0;
 	
 	virtual void genCCall(string& cfuncname, vector<int> &arg_dtypes, bool has_va_arg)=0;
 	virtual void genSysCall(int id, const string& comment)=0;
@@ -71,9 +82,18 @@ public:
 	virtual void genMod(PlnGenEntity* tgt, PlnGenEntity* second, string comment)=0;
 	virtual int genCmp(PlnGenEntity* first, PlnGenEntity* second, int cmp_type, string comment)=0;
 	virtual int genMoveCmpFlag(PlnGenEntity* tgt, int cmp_type, string comment)=0;
+	virtual void genCondMove(PlnGenEntity* tgt, PlnGenEntity* src, int cmp_type, string comment)=0;
+	virtual void genMinMax(PlnGenEntity* tgt, PlnGenEntity* second, bool is_min, string comment)=0;
+	virtual void genIntrinsic(int intrinsic, PlnGenEntity* tgt, PlnGenEntity* second, string comment)=0;
+	virtual void genBitIntrinsic(int intrinsic, int size, PlnGenEntity* tgt, PlnGenEntity* second, string comment)=0;
+	virtual void genFMA(PlnGenEntity* tgt, PlnGenEntity* first, PlnGenEntity* second, int fma_type, string comment)=0;
 	
 	virtual void genNullClear(vector<unique_ptr<PlnGenEntity>> &refs) = 0;
 	virtual void genMemCopy(int cp_unit, string& comment)=0;
+	virtual void genUnrolledMemCopy(uint64_t cp_size, string& comment)=0;
+	virtual void genPtrTableInit(uint64_t ptr_num, uint64_t item_size, int jmp_id, string& comment)=0;
+	virtual void genVectorLoop(vector<PlnVecCode>& codes, int data_type, int item_size,
+			vector<unique_ptr<PlnGenEntity>>& args, vector<unique_ptr<PlnGenEntity>>& rets, int loop_id, int end_id)=0;
 
 	virtual unique_ptr<PlnGenEntity> getEntity(PlnDataPlace* dp)=0;
 
@@ -100,6 +100,10 @@ string PlnMessage::getErr(PlnErrCode err_code, string arg1, string arg2)
 			f = "Incompatible options are specifiled"; break;
 		case E_CUI_InvalidExecOpt:
 			f = "Excecute option use only with output option"; break;
+		case E_CUI_UnknownArch:
+			f = "Unknown target architecture '%1%'"; break;
+		case E_CUI_InvalidFPContract:
+			f = "Invalid fp-contract mode '%1%'"; break;
 
 		case E_UnsupportedGrammer:
 			f = "Unsupported grammer: %1%"; break;
@@ -136,6 +140,20 @@ const char* PlnMessage::getHelp(PlnHelpCode help_code)
 			return "Execute immediately after output executable file";
 		case H_Input:
 			return "Specify input palan source file";
+		case H_StackAllocLimit:
+			return "Max bytes of object allocated on stack (0: disable)";
+		case H_StackAllocReport:
+			return "Report objects allocated on stack automatically";
+		case H_PoolAlloc:
+			return "Use pool allocator (don't mix with C malloc/free)";
+		case H_PoolAllocStats:
+			return "Output allocation counters of pool allocator at exit";
+		case H_March:
+			return "Target CPU (x86-64, x86-64-v2, x86-64-v3, native)";
+		case H_FPContract:
+			return "Fuse float multiply-add (fast, off: strict IEEE)";
+		case H_OmitFramePointer:
+			return "Use RBP as general register instead of frame pointer";
 	}
 	BOOST_ASSERT(false);
 }	// LCOV_EXCL_LINE
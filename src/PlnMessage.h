@@ -54,6 +54,8 @@ enum PlnErrCode {
 	E_CUI_NoInputFile,
 	E_CUI_IncompatibleOpt,
 	E_CUI_InvalidExecOpt,
+	E_CUI_UnknownArch,	// arch name
+	E_CUI_InvalidFPContract,	// mode
 
 	// Unsupported grammer
 	E_UnsupportedGrammer // any, any
@@ -66,7 +68,14 @@ enum PlnHelpCode {
 	H_Compile,
 	H_Output,
 	H_Execute,
-	H_Input
+	H_Input,
+	H_StackAllocLimit,
+	H_StackAllocReport,
+	H_PoolAlloc,
+	H_PoolAllocStats,
+	H_March,
+	H_FPContract,
+	H_OmitFramePointer
 };
 
 class PlnMessage
@@ -3,6 +3,7 @@
 /// @file	PlnModelTreeBuilder.cpp
 /// @copyright	2018-2021 YAMAGUCHI Toshinobu 
 
+#include <algorithm>
 #include <boost/assert.hpp>
 #include <boost/range/adaptor/reversed.hpp>
 #include "PlnModel.h"
@@ -11,6 +12,8 @@
 #include "PlnConstants.h"
 #include "PlnMessage.h"
 #include "PlnException.h"
+#include "PlnGenerator.h"
+#include "PlnDataAllocator.h"
 #include "models/PlnType.h"
 #include "models/PlnModule.h"
 #include "models/PlnFunction.h"
@@ -30,11 +33,15 @@
 #include "models/expressions/PlnStructMember.h"
 #include "models/expressions/PlnReferenceValue.h"
 #include "models/expressions/PlnArrayValue.h"
+#include "models/expressions/PlnVectorLoop.h"
+#include "models/expressions/PlnFMAOperation.h"
+#include "models/expressions/PlnIntrinsic.h"
 #include "models/types/PlnFixedArrayType.h"
 #include "models/types/PlnArrayValueType.h"
 #include "models/types/PlnStructType.h"
 
 static void registerPrototype(json& proto, PlnScopeStack& scope);
+static bool isEscapeVar(json& j, const string& var_name);
 static void buildFunction(json& func, PlnScopeStack &scope, json& ast);
 static PlnStatement* buildStatement(json& stmt, PlnScopeStack &scope, json& ast);
 static PlnBlock* buildBlock(json& stmts, PlnScopeStack &scope, json& ast, PlnBlock* new_block = NULL);
@@ -73,7 +80,10 @@ static PlnExpression* buildDstValue(json dval, PlnScopeStack &scope);
 #define throw_AST_err(j)	{ PlnCompileError err(E_InvalidAST, __FILE__, to_string(__LINE__)); setLoc(&err, j); throw err; }
 #define assertAST(check,j)	{ if (!(check)) throw_AST_err(j); }
 
-PlnModelTreeBuilder::PlnModelTreeBuilder()
+PlnModelTreeBuilder::PlnModelTreeBuilder() : stack_alloc_limit(256), do_auto_move(true), do_ret_storage(true),
+	do_contiguous_alloc(true), do_region_alloc(true), do_rodata_bind(true), do_vectorize(true),
+	do_fp_contract(false), do_intrinsic(true), do_struct_byval(true), do_tail_call(true),
+	has_round_insn(false)
 {
 }
 
@@ -97,6 +107,18 @@ PlnModule* PlnModelTreeBuilder::buildModule(json& ast)
 	assertAST(stmts.is_array() || stmts.is_null(), ast);
 
 	PlnModule *module = new PlnModule();
+	module->stack_alloc_limit = stack_alloc_limit;
+	module->do_auto_move = do_auto_move;
+	module->do_ret_storage = do_ret_storage;
+	module->do_contiguous_alloc = do_contiguous_alloc;
+	module->do_region_alloc = do_region_alloc;
+	module->do_rodata_bind = do_rodata_bind;
+	module->do_vectorize = do_vectorize;
+	module->do_fp_contract = do_fp_contract;
+	module->do_intrinsic = do_intrinsic;
+	module->do_struct_byval = do_struct_byval;
+	module->do_tail_call = do_tail_call;
+	module->has_round_insn = has_round_insn;
 	PlnScopeStack scope;
 	scope.push_back(module);
 
@@ -342,6 +364,19 @@ void registerPrototype(json& proto, PlnScopeStack& scope)
 		setLoc(f, proto);
 	}
 	
+	if (f->type == FT_C) {
+		f->setByValStructs({});
+
+	} else if (f->type == FT_PLN && module.do_struct_byval) {
+		// The parameter placed on the stack can't pass its ownership.
+		vector<string> escape_params;
+		if (proto["impl"].is_object())
+			for (auto p: f->parameters)
+				if (isEscapeVar(proto["impl"], p->var->name))
+					escape_params.push_back(p->var->name);
+		f->setByValStructs(escape_params);
+	}
+
 	vector<string> param_types = f->getParamStrs();
 
 	if (CUR_BLOCK->getFuncProto(f->name, param_types)) {
@@ -423,6 +458,62 @@ static json& getFuncDef(json& ast, int id)
 	BOOST_ASSERT(false);
 } // LCOV_EXCL_LINE
 
+// Check the function implementation can be built as the variant.
+static bool canBuildVariant(json& j)
+{
+	if (j.is_object()) {
+		// The nested function can be built only once.
+		if (j.value("stmt-type", "") == "func-def")
+			return false;
+		// Return values can't be set to the parameter.
+		if (j.value("stmt-type", "") == "return" && j["ret-vals"].size())
+			return false;
+		for (json& e: j)
+			if (!canBuildVariant(e)) return false;
+
+	} else if (j.is_array()) {
+		for (json& e: j)
+			if (!canBuildVariant(e)) return false;
+	}
+
+	return true;
+}
+
+// Register the variant of the function that returns the object
+// using the storage passed by the caller.
+// e.g.) func f(int32 a) -> [3]int32 r  =>  func f.rv(int32 a, [3]int32 >>r) -> [3]int32 r
+static void registerRetStorageFunc(json& stmt, json& func, PlnScopeStack& scope)
+{
+	PlnFunction* f = CUR_BLOCK->funcs.back();
+	if (f->return_vals.size() != 1)
+		return;
+
+	PlnReturnValue& rv = f->return_vals[0];
+	if (rv.is_share_with_param || rv.local_var->name == "")
+		return;
+	if (rv.var_type->data_type() != DT_OBJECT_REF || rv.var_type->mode != "wmh")
+		return;
+
+	for (auto p: f->parameters)
+		if (p->dflt_value)
+			return;
+
+	if (!canBuildVariant(func["impl"]))
+		return;
+
+	json variant = func;
+	variant["name"] = f->name + ".rv";
+	json& ret = func["rets"][0];
+	variant["params"].push_back({
+		{"io", "in"}, {"moveto", "callee"},
+		{"name", ret["name"]}, {"var-type", ret["var-type"]}, {"loc", ret["loc"]}
+	});
+
+	stmt["ret-storage-func"] = variant;
+	registerPrototype(stmt["ret-storage-func"], scope);
+	f->ret_storage_func = CUR_BLOCK->funcs.back();
+}
+
 static void prebuildBlock(json& stmts, PlnScopeStack& scope, json& ast)
 {
 	// Register const&type&extern
@@ -444,10 +535,402 @@ static void prebuildBlock(json& stmts, PlnScopeStack& scope, json& ast)
 		if (type == "func-def") {
 			json& f = getFuncDef(ast, stmt["id"]);
 			registerPrototype(f, scope);
+			if (CUR_MODULE->do_ret_storage && f["func-type"] == "palan")
+				registerRetStorageFunc(stmt, f, scope);
+		}
+	}
+}
+
+static bool hasVar(json& j, const string& var_name)
+{
+	if (j.is_object()) {
+		if (j.value("exp-type", "") == "var" && j.value("var-name", "") == var_name)
+			return true;
+		for (json& e: j)
+			if (hasVar(e, var_name)) return true;
+
+	} else if (j.is_array()) {
+		for (json& e: j)
+			if (hasVar(e, var_name)) return true;
+	}
+
+	return false;
+}
+
+// Check the ownership of the variable moves to/from other or not.
+// Note: The variable of the same name in other scope is also detected.
+static bool isEscapeVar(json& j, const string& var_name)
+{
+	if (j.is_array()) {
+		for (json& e: j)
+			if (isEscapeVar(e, var_name)) return true;
+		return false;
+	}
+
+	if (!j.is_object())
+		return false;
+
+	if (j.value("stmt-type", "") == "return")
+		return hasVar(j, var_name);
+
+	if (j.value("exp-type", "") == "asgn") {
+		// e.g.) a ->> b
+		for (json& dval: j["dst-vals"])
+			if (dval.value("get-owner", false) && hasVar(j, var_name))
+				return true;
+
+	} else if (j.value("stmt-type", "") == "var-init") {
+		// e.g.) [3]int32 b <<= a;
+		for (json& var: j["vars"])
+			if (var.value("get-owner", false) && hasVar(j["inits"], var_name))
+				return true;
+	}
+
+	// e.g.) f(a>>), f(a!)
+	if (j.value("arg-option", "none") != "none")
+		if (hasVar(j, var_name)) return true;
+
+	// e.g.) f() -> >>a
+	if (j.value("get-owner", false) && hasVar(j, var_name))
+		return true;
+
+	for (json& e: j)
+		if (isEscapeVar(e, var_name)) return true;
+
+	return false;
+}
+
+// Mark the object variables that can be allocated on stack.
+static void markNonEscapeVars(json& stmts)
+{
+	for (int i=0; i<stmts.size(); i++) {
+		json& stmt = stmts[i];
+		if (stmt["stmt-type"] != "var-init")
+			continue;
+
+		for (json& var: stmt["vars"]) {
+			if (var["get-owner"] == true)
+				continue;
+
+			bool is_escape = false;
+			for (int j=i+1; j<stmts.size(); j++) {
+				if (isEscapeVar(stmts[j], var["name"])) {
+					is_escape = true;
+					break;
+				}
+			}
+
+			if (!is_escape)
+				var["no-escape"] = true;
+		}
+	}
+}
+
+// Find the minimum index depth of the variable used as assignment destination.
+// e.g.) 3 -> a[1][2]: 2,  b -> a[1]: 1,  c -> a: 0
+static void findDstIndexDepth(json& j, const string& var_name, int& depth)
+{
+	if (j.is_array()) {
+		for (json& e: j)
+			findDstIndexDepth(e, var_name, depth);
+		return;
+	}
+
+	if (!j.is_object())
+		return;
+
+	if (j.value("exp-type", "") == "asgn") {
+		for (json& dval: j["dst-vals"]) {
+			json* e = &dval["exp"];
+			int d = 0;
+			while (e->value("exp-type", "") == "index") {
+				e = &(*e)["base-exp"];
+				d++;
+			}
+			if (e->value("exp-type", "") == "var" && e->value("var-name", "") == var_name
+					&& (depth < 0 || d < depth))
+				depth = d;
+		}
+	}
+
+	for (json& e: j)
+		findDstIndexDepth(e, var_name, depth);
+}
+
+// Mark how deep the items of non-escape variable are replaced.
+// The nested arrays that only the leaf items are updated can be allocated in one block.
+static void markDstIndexDepth(json& stmts)
+{
+	for (int i=0; i<stmts.size(); i++) {
+		json& stmt = stmts[i];
+		if (stmt["stmt-type"] != "var-init" || stmt["inits"].is_array())
+			continue;
+
+		for (json& var: stmt["vars"]) {
+			if (!var.value("no-escape", false))
+				continue;
+
+			int depth = -1;	// -1: not replaced.
+			for (int j=i+1; j<stmts.size(); j++)
+				findDstIndexDepth(stmts[j], var["name"], depth);
+			var["dst-index-depth"] = depth;
 		}
 	}
 }
 
+static bool canAllocOnStack(PlnVarType* t)
+{
+	if (t->mode[ALLOC_MD] != 'h' || t->has_heap_member())
+		return false;
+
+	int type = t->typeinf->type;
+	return type == TP_FIXED_ARRAY || type == TP_STRUCT;
+}
+
+// Place the large objects that don't escape in one region of the block.
+// The region is allocated at the beginning of the block and released at once.
+static void placeRegionVars(json& stmts, PlnScopeStack& scope)
+{
+	uint64_t region_size = 0;
+	for (int i=0; i<stmts.size(); i++) {
+		json& stmt = stmts[i];
+		if (stmt["stmt-type"] != "var-init" || stmt["inits"].is_array())
+			continue;
+
+		json* pre_var_type = NULL;
+		for (json& var: stmt["vars"]) {
+			// Make the type explicit not to take over the region type.
+			if (var["var-type"].is_null() && pre_var_type)
+				var["var-type"] = *pre_var_type;
+			pre_var_type = &var["var-type"];
+
+			if (!var.value("no-escape", false) || var["var-type"].is_null()
+					|| var["var-type"][0]["mode"] != "---")
+				continue;
+
+			// The object replaced entirely can get the ownership by move.
+			int depth = -1;
+			for (int j=i+1; j<stmts.size(); j++)
+				findDstIndexDepth(stmts[j], var["name"], depth);
+			if (depth == 0)
+				continue;
+
+			int size;
+			try {
+				if (!canAllocOnStack(getVarTypeFromJson(var["var-type"], scope)))
+					continue;
+				json body_type = var["var-type"];
+				body_type[0]["mode"] = "wis";
+				size = getVarTypeFromJson(body_type, scope)->size();
+
+			} catch (PlnCompileError &err) {
+				continue;	// The error is reported at building the variable.
+			}
+
+			if (size <= CUR_MODULE->stack_alloc_limit)
+				continue;
+
+			var["region-offset"] = region_size;
+			region_size += (size + 15) & ~15;
+		}
+	}
+
+	if (!region_size)
+		return;
+
+	json region_type = {
+		{{"name", "[]"}, {"mode", "---"}, {"sizes", {{{"exp-type", "lit-uint"}, {"val", region_size}}}}},
+		{{"name", "byte"}, {"mode", "---"}}
+	};
+	json region_init = {
+		{"stmt-type", "var-init"},
+		{"vars", {{{"name", "__region"}, {"var-type", region_type}}}}
+	};
+	stmts.insert(stmts.begin(), region_init);
+}
+
+// Check the variable is used as source of assignment or initialization.
+// The value may be bound to a reference.
+static bool isSourceVar(json& j, const string& var_name)
+{
+	if (j.is_array()) {
+		for (json& e: j)
+			if (isSourceVar(e, var_name)) return true;
+		return false;
+	}
+
+	if (!j.is_object())
+		return false;
+
+	if (j.value("exp-type", "") == "asgn" && hasVar(j["src-exps"], var_name))
+		return true;
+
+	if (j.value("stmt-type", "") == "var-init" && hasVar(j["inits"], var_name))
+		return true;
+
+	for (json& e: j)
+		if (isSourceVar(e, var_name)) return true;
+
+	return false;
+}
+
+// Check the variable is used only to read the items.
+// e.g.) OK: a[1] -> b, f(a[i])  NG: 3 -> a[1], a[0]++, f(a), b = a
+static bool isItemReadOnly(json& j, const string& var_name)
+{
+	if (j.is_array()) {
+		for (json& e: j)
+			if (!isItemReadOnly(e, var_name)) return false;
+		return true;
+	}
+
+	if (!j.is_object())
+		return true;
+
+	if (j.value("exp-type", "") == "var" && j.value("var-name", "") == var_name)
+		return false;
+
+	auto isItemOfVar = [&var_name](json& e) {
+		return e.value("exp-type", "") == "index" && e["base-exp"].value("exp-type", "") == "var"
+			&& e["base-exp"].value("var-name", "") == var_name;
+	};
+
+	if (j.value("exp-type", "") == "asgn") {
+		for (json& dval: j["dst-vals"])
+			if (isItemOfVar(dval["exp"])) return false;
+	}
+
+	if (j.value("stmt-type", "") == "ope-asgn" && isItemOfVar(j["dst-val"]))
+		return false;
+
+	if (isItemOfVar(j)) {
+		if (j.value("arg-option", "none") != "none")
+			return false;
+		return isItemReadOnly(j["indexes"], var_name);
+	}
+
+	for (json& e: j)
+		if (!isItemReadOnly(e, var_name)) return false;
+
+	return true;
+}
+
+// Mark the variables initialized by array value and never updated.
+// The variable can refer the read only data of the value without copy.
+static void markReadOnlyVars(json& stmts)
+{
+	for (int i=0; i<stmts.size(); i++) {
+		json& stmt = stmts[i];
+		if (stmt["stmt-type"] != "var-init" || !stmt["inits"].is_array())
+			continue;
+
+		for (json& var: stmt["vars"]) {
+			if (var["get-owner"] == true
+					|| (var["var-type"].size() && var["var-type"][0]["mode"] != "---"))
+				continue;
+
+			bool is_read_only = true;
+			for (int j=i+1; j<stmts.size(); j++) {
+				if (!isItemReadOnly(stmts[j], var["name"])) {
+					is_read_only = false;
+					break;
+				}
+			}
+
+			if (is_read_only)
+				var["read-only"] = true;
+		}
+	}
+}
+
+// Mark the assignments that can move ownership instead of copy.
+// e.g.) [3]int32 a, b; ... a -> b; (a is not used after that)
+static void markLastUseAssignments(json& stmts)
+{
+	for (int i=0; i<stmts.size(); i++) {
+		json& stmt = stmts[i];
+		json* src;
+		json* marked;
+		string dst_name;
+		if (stmt["stmt-type"] == "exp" && stmt["exp"].value("exp-type", "") == "asgn") {
+			json& asgn = stmt["exp"];
+			if (asgn["src-exps"].size() != 1 || asgn["dst-vals"].size() != 1)
+				continue;
+			json& dval = asgn["dst-vals"][0];
+			if (dval.value("get-owner", false) || dval["exp"].value("exp-type", "") != "var")
+				continue;
+			src = &asgn["src-exps"][0];
+			dst_name = dval["exp"]["var-name"];
+			marked = &asgn;
+
+		} else if (stmt["stmt-type"] == "var-init") {
+			// e.g.) [3]int32 b = a;
+			if (!stmt["inits"].is_array() || stmt["inits"].size() != 1 || stmt["vars"].size() != 1)
+				continue;
+			if (stmt["vars"][0].value("get-owner", false))
+				continue;
+			src = &stmt["inits"][0];
+			dst_name = stmt["vars"][0]["name"];
+			marked = &stmt;
+
+		} else
+			continue;
+
+		if (src->value("exp-type", "") != "var" || src->value("arg-option", "none") != "none")
+			continue;
+
+		string var_name = (*src)["var-name"];
+		if (var_name == dst_name)
+			continue;
+
+		// Only the variable declared in this block.
+		int decl_i = -1;
+		for (int j=0; j<i; j++) {
+			if (stmts[j]["stmt-type"] != "var-init")
+				continue;
+			for (json& var: stmts[j]["vars"])
+				if (var["name"] == var_name)
+					decl_i = j;
+		}
+		if (decl_i < 0)
+			continue;
+
+		// Keep the error of copying to freed variable.
+		bool can_move = true;
+		for (int j=0; j<i; j++) {
+			if (isEscapeVar(stmts[j], dst_name)) {
+				can_move = false;
+				break;
+			}
+		}
+
+		for (int j=decl_i+1; can_move && j<i; j++) {
+			if (isSourceVar(stmts[j], var_name)) {
+				can_move = false;
+				break;
+			}
+		}
+
+		for (int j=i+1; can_move && j<stmts.size(); j++) {
+			if (hasVar(stmts[j], var_name)) {
+				can_move = false;
+				break;
+			}
+		}
+
+		if (can_move)
+			(*marked)["last-use"] = true;
+	}
+}
+
+// Check the ownership of src object can be moved to dst instead of copy.
+static bool canMoveOwnership(PlnVarType* dst, PlnVarType* src)
+{
+	return src->mode[IDENTITY_MD] == 'm' && src->mode[ALLOC_MD] == 'h'
+		&& dst->mode[IDENTITY_MD] == 'm' && dst->mode[ALLOC_MD] == 'h'
+		&& dst->canCopyFrom(src, ASGN_MOVE) == TC_SAME;
+}
+
 PlnBlock* buildBlock(json& stmts, PlnScopeStack &scope, json& ast, PlnBlock* new_block)
 {
 	PlnBlock* block = new_block ? new_block : new PlnBlock();
@@ -463,6 +946,18 @@ PlnBlock* buildBlock(json& stmts, PlnScopeStack &scope, json& ast, PlnBlock* new
 
 	scope.push_back(block);
 	prebuildBlock(stmts, scope, ast);
+	if (CUR_MODULE->stack_alloc_limit > 0 || CUR_MODULE->do_contiguous_alloc
+			|| CUR_MODULE->do_region_alloc)
+		markNonEscapeVars(stmts);
+	if (CUR_MODULE->do_contiguous_alloc)
+		markDstIndexDepth(stmts);
+	if (CUR_MODULE->do_rodata_bind)
+		markReadOnlyVars(stmts);
+	if (CUR_MODULE->do_region_alloc)
+		placeRegionVars(stmts, scope);
+	if (CUR_MODULE->do_auto_move)
+		markLastUseAssignments(stmts);
+
 	for (json& stmt: stmts) {
 		if (PlnStatement* s = buildStatement(stmt, scope, ast))
 			block->statements.push_back(s);
@@ -513,8 +1008,11 @@ PlnStatement* buildStatement(json& stmt, PlnScopeStack &scope, json& ast)
 
 	} else if (type == "func-def") {
 		json& f = getFuncDef(ast, stmt["id"]);
-		if (f["func-type"] == "palan")
+		if (f["func-type"] == "palan") {
 			buildFunction(f, scope, ast);
+			if (stmt.contains("ret-storage-func"))
+				buildFunction(stmt["ret-storage-func"], scope, ast);
+		}
 		return NULL;
 	
 	} else if (type == "type-def") {
@@ -625,7 +1123,13 @@ PlnVarInit* buildVarInit(json& var_init, PlnScopeStack &scope)
 	vector<PlnVarType*> types;
 	int init_ex_ind = 0;
 	int init_val_ind = 0;
+	json pre_var_type;
+	bool stack_alloc = false;
 	for (json &var: var_init["vars"]) {
+		// Don't take over the stack allocation from the previous variable.
+		if (var["var-type"].is_null() && stack_alloc)
+			var["var-type"] = pre_var_type;
+
 		InferenceType infer = checkNeedsTypeInference(var["var-type"]);
 		if (infer != NO_INFER) {
 			if (init_ex_ind >= inits.size()) {
@@ -682,6 +1186,46 @@ PlnVarInit* buildVarInit(json& var_init, PlnScopeStack &scope)
 			t = getVarTypeFromJson(var["var-type"], scope);
 		}
 
+		PlnVarType* decl_t = t;
+
+		// Refer the literal data of the array value directly instead of the copy.
+		if (var.value("read-only", false) && t && t->mode == "wmh"
+				&& t->typeinf->type == TP_FIXED_ARRAY && init_ex_ind < inits.size()
+				&& inits[init_ex_ind]->type == ET_VALUE && inits[init_ex_ind]->values.size() == 1
+				&& inits[init_ex_ind]->values[0].type == VL_LIT_ARRAY) {
+			int item_dtype = static_cast<PlnFixedArrayVarType*>(t)->item_type()->data_type();
+			PlnVarType* val_type = inits[init_ex_ind]->values[0].getVarType();
+			if (item_dtype != DT_OBJECT && item_dtype != DT_OBJECT_REF
+					&& t->canCopyFrom(val_type, ASGN_COPY) != TC_CANT_CONV)
+				t = t->getVarType("rir");
+		}
+
+		// Allocate the object that doesn't escape on stack as same as '$'.
+		stack_alloc = false;
+		if (var.value("no-escape", false) && infer != TYPE_INFER && t
+				&& var["var-type"][0]["mode"] == "---" && canAllocOnStack(t)) {
+			json stack_var_type = var["var-type"];
+			stack_var_type[0]["mode"] = "wis";
+			PlnVarType* st = getVarTypeFromJson(stack_var_type, scope);
+			if (st->size() > 0 && st->size() <= CUR_MODULE->stack_alloc_limit) {
+				pre_var_type = var["var-type"];
+				t = st;
+				stack_alloc = true;
+			}
+		}
+
+		// Take the place in the region of the block instead of allocation.
+		PlnVariable* region = NULL;
+		if (var.contains("region-offset")) {
+			region = CUR_BLOCK->getVariable("__region");
+			BOOST_ASSERT(region && t);
+			t = t->getVarType("wcr");
+		}
+
+		// Diagnostics show the type in the code.
+		if (t != decl_t)
+			t->decl_type = decl_t;
+
 		bool do_check_ancestor_blocks = (infer == TYPE_INFER);
 
 		PlnVariable *v = CUR_BLOCK->declareVariable(var["name"], t, do_check_ancestor_blocks);
@@ -690,12 +1234,34 @@ PlnVarInit* buildVarInit(json& var_init, PlnScopeStack &scope)
 			setLoc(&err, var);
 			throw err;
 		}
+		if (region) {
+			v->container = region;
+			v->region_offset = var["region-offset"];
+		}
 		vars.push_back(v);
 		types.push_back(v->var_type);
 
+		// Allocate nested arrays in one block when only the leaf items are updated.
+		if (var.contains("dst-index-depth") && v->var_type->mode == "wmh"
+				&& v->var_type->typeinf->type == TP_FIXED_ARRAY) {
+			vector<std::pair<uint64_t, uint64_t>> tables;
+			uint64_t alloc_size;
+			auto farr_type = static_cast<PlnFixedArrayVarType*>(v->var_type);
+			if (farr_type->getContiguousLayout(tables, alloc_size)) {
+				int depth = var["dst-index-depth"];
+				if (depth < 0 || depth > tables.size())
+					v->is_contiguous = true;
+			}
+		}
+
 		// set asgn_type
 		if (var["get-owner"] == true) {
 			vars.back().asgn_type = ASGN_MOVE;
+		} else if (var_init.value("last-use", false) && inits[0]->type == ET_VALUE
+				&& inits[0]->values[0].type == VL_VAR && !inits[0]->values[0].inf.var->is_contiguous
+				&& canMoveOwnership(v->var_type, inits[0]->values[0].getVarType())) {
+			// The initial object is not used after this.
+			vars.back().asgn_type = ASGN_MOVE;
 		} else if (v->var_type->data_type() == DT_OBJECT_REF && v->var_type->mode[ALLOC_MD] == 'r') {
 			vars.back().asgn_type = ASGN_COPY_REF;
 		} else {
@@ -703,6 +1269,8 @@ PlnVarInit* buildVarInit(json& var_init, PlnScopeStack &scope)
 		}
 
 		setLoc(v, var);
+		if (stack_alloc)
+			CUR_MODULE->stack_alloc_vars.push_back(v);
 
 		if (init_ex_ind < inits.size()) {
 			if (init_val_ind+1 < inits[init_ex_ind]->values.size()) {
@@ -821,6 +1389,39 @@ void registerExternVar(json& var, PlnScopeStack &scope)
 	}
 }
 
+// Tail recursion that can be replaced by parameters update.
+// Only primitive parameters and return values are supported.
+static bool isSelfTailCall(PlnExpression* e, PlnFunction* f)
+{
+	if (e->type != ET_FUNCCALL)
+		return false;
+	auto fcall = static_cast<PlnFunctionCall*>(e);
+	if (fcall->function != f || f->has_va_arg)
+		return false;
+
+	for (auto p: f->parameters) {
+		int dt = p->var->var_type->data_type();
+		if (p->passby != FPM_IN_BYVAL || p->byval_struct || dt == DT_OBJECT || dt == DT_OBJECT_REF)
+			return false;
+	}
+	for (auto& rv: f->return_vals) {
+		int dt = rv.var_type->data_type();
+		if (dt == DT_OBJECT || dt == DT_OBJECT_REF)
+			return false;
+	}
+
+	if (fcall->arguments.size() != f->parameters.size())
+		return false;
+	for (auto& arg: fcall->arguments) {
+		if (!arg.exp || arg.inf.size() != 1 || arg.exp->values.size() != 1)
+			return false;
+		if (arg.inf[0].opt != AG_NONE)
+			return false;
+	}
+
+	return true;
+}
+
 PlnStatement* buildReturn(json& ret, PlnScopeStack& scope)
 {
 	if (!CUR_FUNC) {
@@ -853,6 +1454,24 @@ PlnStatement* buildReturn(json& ret, PlnScopeStack& scope)
 		}
 		ret_vals[ri] = e->adjustTypes(types);
 	}
+
+	// e.g.) return f(n-1, a*n); => n-1, a*n -> n, a; and jump to head of f.
+	if (CUR_MODULE->do_tail_call && ret_vals.size() == 1 && isSelfTailCall(ret_vals[0], f)) {
+		auto fcall = static_cast<PlnFunctionCall*>(ret_vals[0]);
+		vector<PlnExpression*> dsts, srcs;
+		for (auto& arg: fcall->arguments) {
+			auto dst_ex = new PlnExpression(arg.inf[0].param->var);
+			dst_ex->values[0].asgn_type = ASGN_COPY;
+			dsts.push_back(dst_ex);
+			srcs.push_back(arg.exp);
+			arg.exp = NULL;
+		}
+		delete fcall;
+
+		if (f->tail_jmp_id < 0)
+			f->tail_jmp_id = CUR_MODULE->getJumpID();
+		return new PlnReturnStmt(new PlnAssignment(dsts, srcs), CUR_BLOCK);
+	}
 	
 	try {
 		return new PlnReturnStmt(ret_vals, CUR_BLOCK);
@@ -864,14 +1483,266 @@ PlnStatement* buildReturn(json& ret, PlnScopeStack& scope)
 	}
 }
 
+// Vectorization of simple counted loop.
+// e.g.) while i < n { a[i] * k + b[i] -> c[i]; i++; }
+//       while i < n { s + a[i] -> s; i + 1 -> i; }
+struct VecLoopInf {
+	string index, sum;
+	PlnTypeInfo* item_type = NULL;
+	vector<json> args;	// index, limit, arrays and scalars(, sum)
+	vector<PlnVecCode> codes;
+};
+
+static bool isVar(json& exp, const string& name)
+{
+	return exp.value("exp-type", "") == "var" && exp.value("var-name", "") == name;
+}
+
+static PlnVariable* getVecScalarVar(json& exp, PlnScopeStack& scope)
+{
+	if (exp.value("exp-type", "") != "var" || exp.value("arg-option", "none") != "none")
+		return NULL;
+	PlnVariable* var = CUR_BLOCK->getVariable(exp["var-name"]);
+	if (!var || var->var_type->typeinf->type != TP_PRIMITIVE || var->var_type->data_type() == DT_OBJECT_REF)
+		return NULL;
+	return var;
+}
+
+// a[i]: one dimensional array of 4/8 byte numbers.
+static PlnVariable* getVecArrayVar(json& exp, VecLoopInf& inf, PlnScopeStack& scope)
+{
+	if (exp.value("exp-type", "") != "index" || exp.value("arg-option", "none") != "none")
+		return NULL;
+	json& base = exp["base-exp"];
+	json& indexes = exp["indexes"];
+	if (base.value("exp-type", "") != "var" || indexes.size() != 1 || !isVar(indexes[0], inf.index))
+		return NULL;
+
+	PlnVariable* var = CUR_BLOCK->getVariable(base["var-name"]);
+	if (!var) return NULL;
+	auto t = dynamic_cast<PlnFixedArrayVarType*>(var->var_type);
+	if (!t || t->sizes.size() != 1)
+		return NULL;
+
+	PlnTypeInfo* item_type = t->item_type()->typeinf;
+	if (item_type->type != TP_PRIMITIVE || !(item_type->data_size == 4 || item_type->data_size == 8))
+		return NULL;
+	if (inf.item_type && inf.item_type != item_type)
+		return NULL;
+	inf.item_type = item_type;
+	return var;
+}
+
+static PlnTypeInfo* findVecItemType(json& exp, VecLoopInf& inf, PlnScopeStack& scope)
+{
+	string type = exp.value("exp-type", "");
+	if (type == "index" && getVecArrayVar(exp, inf, scope))
+		return inf.item_type;
+	if (type == "+" || type == "-" || type == "*" || type == "/") {
+		if (PlnTypeInfo* t = findVecItemType(exp["lval"], inf, scope))
+			return t;
+		return findVecItemType(exp["rval"], inf, scope);
+	}
+	return NULL;
+}
+
+static int addVecArg(json& exp, VecLoopInf& inf)
+{
+	if (exp.value("exp-type", "") == "var")
+		for (int i=2; i<inf.args.size(); i++)
+			if (isVar(inf.args[i], exp["var-name"]))
+				return i;
+	inf.args.push_back(exp);
+	return inf.args.size() - 1;
+}
+
+static bool buildVecCodes(json& exp, VecLoopInf& inf, PlnScopeStack& scope)
+{
+	if (exp.value("arg-option", "none") != "none")
+		return false;
+
+	bool is_float = inf.item_type->data_type == DT_FLOAT;
+	string type = exp.value("exp-type", "");
+	int ope = -1;
+	if (type == "+") ope = VOP_ADD;
+	else if (type == "-") ope = VOP_SUB;
+	else if (type == "*" && is_float) ope = VOP_MUL;	// SSE2 has no packed 32/64bit integer multiplication.
+	else if (type == "/" && is_float) ope = VOP_DIV;
+
+	if (ope >= 0) {
+		if (!buildVecCodes(exp["lval"], inf, scope) || !buildVecCodes(exp["rval"], inf, scope))
+			return false;
+		inf.codes.push_back({ope, -1});
+		return true;
+	}
+
+	if (type == "index") {
+		if (!getVecArrayVar(exp, inf, scope))
+			return false;
+		inf.codes.push_back({VOP_LOAD, addVecArg(exp["base-exp"], inf)});
+		return true;
+	}
+
+	if (type == "var") {
+		PlnVariable* var = getVecScalarVar(exp, scope);
+		if (!var || var->name == inf.index || var->name == inf.sum)
+			return false;
+		if (is_float ? var->var_type->typeinf != inf.item_type : var->var_type->data_type() == DT_FLOAT)
+			return false;
+		inf.codes.push_back({VOP_SCALAR, addVecArg(exp, inf)});
+		return true;
+	}
+
+	if ((type == "lit-float" && is_float) || ((type == "lit-int" || type == "lit-uint") && !is_float)) {
+		inf.codes.push_back({VOP_SCALAR, addVecArg(exp, inf)});
+		return true;
+	}
+
+	return false;
+}
+
+// i++ or i + 1 -> i
+static bool isIncrement(json& stmt, const string& index)
+{
+	auto isOne = [](json& exp) {
+		return exp.value("exp-type", "") == "lit-int" && exp["val"] == 1;
+	};
+
+	if (stmt.value("stmt-type", "") == "ope-asgn")
+		return stmt.value("ope", "") == "+" && isVar(stmt["dst-val"], index) && isOne(stmt["rval"]);
+
+	if (stmt.value("stmt-type", "") != "exp" || stmt["exp"].value("exp-type", "") != "asgn")
+		return false;
+	json& asgn = stmt["exp"];
+	if (asgn["src-exps"].size() != 1 || asgn["dst-vals"].size() != 1 || asgn["dst-vals"][0].value("get-owner", false))
+		return false;
+	json& src = asgn["src-exps"][0];
+	return src.value("exp-type", "") == "+" && isVar(src["lval"], index) && isOne(src["rval"])
+		&& isVar(asgn["dst-vals"][0]["exp"], index);
+}
+
+// Returns the block that has the vectorized loop. The rest items are processed by the original loop.
+static PlnBlock* buildVectorLoop(json& whl, PlnScopeStack& scope)
+{
+	json& cond = whl["cond"];
+	json& stmts = whl["block"]["stmts"];
+	if (cond.value("exp-type", "") != "<" || stmts.size() != 2)
+		return NULL;
+
+	VecLoopInf inf;
+	PlnVariable* index_var = getVecScalarVar(cond["lval"], scope);
+	if (!index_var || index_var->var_type->data_type() == DT_FLOAT || index_var->var_type->size() < 4
+			|| index_var->var_type->mode[ACCESS_MD] == 'r')
+		return NULL;
+	inf.index = index_var->name;
+	if (!isIncrement(stmts[1], inf.index))
+		return NULL;
+
+	json& limit = cond["rval"];
+	PlnVariable* limit_var = NULL;
+	if (limit.value("exp-type", "") != "lit-int") {
+		limit_var = getVecScalarVar(limit, scope);
+		if (!limit_var || limit_var == index_var || limit_var->var_type->data_type() == DT_FLOAT)
+			return NULL;
+	}
+
+	json& body = stmts[0];
+	if (body.value("stmt-type", "") != "exp" || body["exp"].value("exp-type", "") != "asgn")
+		return NULL;
+	json& asgn = body["exp"];
+	if (asgn["src-exps"].size() != 1 || asgn["dst-vals"].size() != 1 || asgn["dst-vals"][0].value("get-owner", false))
+		return NULL;
+	json& src = asgn["src-exps"][0];
+	json& dst = asgn["dst-vals"][0]["exp"];
+	if (dst.value("arg-option", "none") != "none" || src.value("arg-option", "none") != "none")
+		return NULL;
+
+	inf.args.push_back(cond["lval"]);
+	inf.args.push_back(limit);
+
+	PlnVariable* sum_var = NULL;
+	json* tree = &src;
+	if (dst.value("exp-type", "") == "index") {	// map: a[i] + b[i] -> c[i]
+		PlnVariable* dst_var = getVecArrayVar(dst, inf, scope);
+		if (!dst_var || dst_var->var_type->mode[ACCESS_MD] == 'r')
+			return NULL;
+
+	} else {	// reduction: s + a[i] -> s
+		sum_var = getVecScalarVar(dst, scope);
+		// The limit must not be updated in the loop.
+		if (!sum_var || sum_var == index_var || sum_var == limit_var || sum_var->var_type->mode[ACCESS_MD] == 'r'
+				|| src.value("exp-type", "") != "+")
+			return NULL;
+		inf.sum = sum_var->name;
+		if (isVar(src["lval"], inf.sum)) tree = &src["rval"];
+		else if (isVar(src["rval"], inf.sum)) tree = &src["lval"];
+		else return NULL;
+
+		// The order of floating point addition changes the result.
+		if (!findVecItemType(*tree, inf, scope) || inf.item_type->data_type == DT_FLOAT
+				|| sum_var->var_type->data_type() == DT_FLOAT || sum_var->var_type->size() != inf.item_type->data_size)
+			return NULL;
+	}
+
+	if (!buildVecCodes(*tree, inf, scope))
+		return NULL;
+
+	if (sum_var) {
+		inf.codes.push_back({VOP_SUM, -1});
+		inf.args.push_back(dst);
+	} else {
+		inf.codes.push_back({VOP_STORE, addVecArg(dst["base-exp"], inf)});
+	}
+
+	// Work registers and argument registers are limited.
+	int work_num = 0, greg_num = 0, xreg_num = 0;
+	for (auto& c: inf.codes)
+		if (c.ope != VOP_SCALAR && c.ope != VOP_STORE && c.ope != VOP_SUM)
+			work_num++;
+	vector<PlnExpression*> args;
+	for (json& a: inf.args) {
+		args.push_back(buildExpression(a, scope));
+		if (args.back()->getDataType() == DT_FLOAT) xreg_num++;
+		else greg_num++;
+	}
+	if (work_num > 6 || greg_num > 6 || xreg_num > 8) {
+		for (auto a: args)
+			delete a;
+		return NULL;
+	}
+
+	PlnBlock* block = new PlnBlock();
+	block->setParent(CUR_BLOCK);
+
+	PlnExpression* vec_loop = new PlnVectorLoop(args, inf.codes, inf.item_type->data_type, inf.item_type->data_size);
+	vector<PlnExpression*> dst_vals = { buildDstValue({{"exp", cond["lval"]}, {"get-owner", false}}, scope) };
+	if (sum_var)
+		dst_vals.push_back(buildDstValue({{"exp", dst}, {"get-owner", false}}, scope));
+	vector<PlnExpression*> src_exps = { vec_loop };
+	PlnExpression* asgn_ex = new PlnAssignment(dst_vals, src_exps);
+	block->statements.push_back(new PlnStatement(asgn_ex, block));
+
+	return block;
+}
+
 PlnStatement* buildWhile(json& whl, PlnScopeStack& scope, json& ast)
 {
+	PlnBlock* vec_block = NULL;
+	if (CUR_MODULE->do_vectorize && (vec_block = buildVectorLoop(whl, scope)))
+		scope.push_back(vec_block);
+
 	PlnExpression* cond = buildExpression(whl["cond"], scope);
 	PlnBlock* stmts_block = new PlnBlock();
 	PlnWhileStatement* while_stmt = new PlnWhileStatement(cond, stmts_block, CUR_BLOCK);
 	buildBlock(whl["block"]["stmts"], scope, ast, stmts_block);
 	setLoc(stmts_block, whl["block"]);
 
+	if (vec_block) {
+		scope.pop_back();
+		vec_block->statements.push_back(while_stmt);
+		return new PlnStatement(vec_block, CUR_BLOCK);
+	}
+
 	return while_stmt;
 }
 
@@ -1053,6 +1924,19 @@ PlnExpression* buildExpression(json& exp, PlnScopeStack &scope)
 	return expression;
 }
 
+static bool hasObjectArg(vector<PlnArgument> &args)
+{
+	for (auto& arg: args) {
+		if (!arg.exp) continue;
+		for (auto& v: arg.exp->values) {
+			int dt = v.getVarType()->data_type();
+			if (dt == DT_OBJECT || dt == DT_OBJECT_REF)
+				return true;
+		}
+	}
+	return false;
+}
+
 PlnExpression* buildFuncCall(json& fcall, PlnScopeStack &scope)
 {
 	vector<PlnArgument> args;
@@ -1128,6 +2012,24 @@ PlnExpression* buildFuncCall(json& fcall, PlnScopeStack &scope)
 
 		PlnFunction* f = CUR_BLOCK->getFunc(fcall["func-name"], arginfs);
 
+		// Pass the destination variable to construct the return value in it.
+		// e.g.) f(1) -> a  =>  f.rv(1, a>>) ->> a
+		// Object arguments may refer the destination. e.g.) @[10]int32 r = a; f(r) -> a
+		if (fcall.contains("ret-storage") && f->ret_storage_func && !hasObjectArg(args)) {
+			PlnExpression* dst_ex = buildExpression(fcall["ret-storage"], scope);
+			if (dst_ex->type == ET_VALUE && dst_ex->values[0].type == VL_VAR
+					&& canMoveOwnership(dst_ex->values[0].getVarType(), f->return_vals[0].var_type)) {
+				f = f->ret_storage_func;
+				args.push_back({dst_ex});
+				args.back().inf.push_back({PIO_INPUT});
+				args.back().inf.back().opt = AG_MOVE;
+				fcall["ret-storage-used"] = true;
+
+			} else {
+				delete dst_ex;
+			}
+		}
+
 		// Map parameter and argument and set default value
 		vector<PlnParameter*> params = f->parameters;
 		int va_index = 0;
@@ -1192,9 +2094,24 @@ PlnExpression* buildFuncCall(json& fcall, PlnScopeStack &scope)
 				arg.exp = arg.exp->adjustTypes(types);
 		}
 
+		// e.g.) sqrtf(x) => sqrtss
+		if (CUR_MODULE->do_intrinsic) {
+			if (PlnExpression* ie = PlnIntrinsic::create(f, args, CUR_MODULE->has_round_insn))
+				return ie;
+		}
+
+		if (f->type == FT_PLN && CUR_FUNC && f != CUR_FUNC
+				&& std::find(CUR_FUNC->callees.begin(), CUR_FUNC->callees.end(), f) == CUR_FUNC->callees.end())
+			CUR_FUNC->callees.push_back(f);
+
 		return new PlnFunctionCall(f, args);
 
 	} catch (PlnCompileError& err) {
+		// e.g.) popcount(x) => popcnt
+		if (err.err_code == E_UndefinedFunction) {
+			if (PlnExpression* be = PlnIntrinsic::createBuiltin(fcall["func-name"], args))
+				return be;
+		}
 		setLoc(&err, fcall);
 		throw;
 	}
@@ -1205,14 +2122,22 @@ PlnExpression* buildAssignment(json& asgn, PlnScopeStack &scope)
 	json& src = asgn["src-exps"];
 	assertAST(src.is_array(), asgn);
 
+	json& dst = asgn["dst-vals"];
+	assertAST(dst.is_array(), asgn);
+
+	// e.g.) f() -> a (a is not used in arguments)
+	if (CUR_MODULE->do_ret_storage && src.size() == 1 && dst.size() == 1
+			&& src[0].value("exp-type", "") == "func-call"
+			&& !dst[0].value("get-owner", false) && dst[0]["exp"].value("exp-type", "") == "var"
+			&& !hasVar(src[0], dst[0]["exp"]["var-name"])) {
+		src[0]["ret-storage"] = dst[0]["exp"];
+	}
+
 	vector<PlnExpression *> src_exps;
 	for (json& exp: src) {
 		src_exps.push_back(buildExpression(exp, scope));
 	}
 
-	json& dst = asgn["dst-vals"];
-	assertAST(dst.is_array(), asgn);
-
 	vector<PlnExpression*> dst_vals;
 	vector<PlnVarType*> types;
 
@@ -1225,6 +2150,17 @@ PlnExpression* buildAssignment(json& asgn, PlnScopeStack &scope)
 
 		types.push_back(dst_vals.back()->values[0].inf.var->var_type);
 
+		// The return value was constructed in the dst variable.
+		if (src_ex_ind == 0 && src[0].value("ret-storage-used", false))
+			dst_vals.back()->values[0].asgn_type = ASGN_MOVE;
+
+		// The source object is not used after this. Move it instead of copy.
+		if (asgn.value("last-use", false) && src_exps[0]->type == ET_VALUE
+				&& src_exps[0]->values[0].type == VL_VAR && !src_exps[0]->values[0].inf.var->is_contiguous
+				&& canMoveOwnership(types.back(), src_exps[0]->values[0].getVarType())) {
+			dst_vals.back()->values[0].asgn_type = ASGN_MOVE;
+		}
+
 		if (dst_vals.back()->values[0].asgn_type == ASGN_MOVE) {
 			// need to much type completely for move.
 			PlnVarType* src_vtype = src_exps[src_ex_ind]->values[src_val_ind].getVarType();
@@ -1419,16 +2355,27 @@ static BinaryEx getBiEx(json& biope, PlnScopeStack &scope)
 	return bex;
 }
 
+// e.g.) c + a * b => fma(c, a, b)
+static PlnExpression* contractFMA(PlnExpression* ex, PlnScopeStack &scope)
+{
+	if (!CUR_MODULE->do_fp_contract)
+		return ex;
+
+	if (PlnExpression* fma = PlnFMAOperation::create(ex))
+		return fma;
+	return ex;
+}
+
 PlnExpression* buildAddOperation(json& add, PlnScopeStack &scope)
 {
 	BinaryEx bex = getBiEx(add, scope);
-	return PlnAddOperation::create(bex.l, bex.r);
+	return contractFMA(PlnAddOperation::create(bex.l, bex.r), scope);
 }
 
 PlnExpression* buildSubOperation(json& sub, PlnScopeStack &scope)
 {
 	BinaryEx bex = getBiEx(sub, scope);
-	return PlnAddOperation::create_sub(bex.l, bex.r);
+	return contractFMA(PlnAddOperation::create_sub(bex.l, bex.r), scope);
 }
 
 PlnExpression* buildMulOperation(json& mul, PlnScopeStack &scope)
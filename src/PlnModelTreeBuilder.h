@@ -10,6 +10,19 @@ class PlnModule;
 class PlnModelTreeBuilder
 {
 public:
+	int stack_alloc_limit;	// 0: disable auto stack allocation.
+	bool do_auto_move;	// Move ownership instead of copy at last use.
+	bool do_ret_storage;	// Construct object return value in caller's variable.
+	bool do_contiguous_alloc;	// Allocate nested arrays in one block.
+	bool do_region_alloc;	// Allocate large local objects in the region of block.
+	bool do_rodata_bind;	// Bind read only arrays to the literal data directly.
+	bool do_vectorize;	// Process simple loops of arrays by packed instructions.
+	bool do_fp_contract;	// Fuse float multiply and add. (Not strict IEEE)
+	bool do_intrinsic;	// Process well-known C functions inline.
+	bool do_struct_byval;	// Pass small structs in registers instead of clone.
+	bool do_tail_call;	// Process self tail recursion as loop.
+	bool has_round_insn;	// Target has float rounding instruction. (e.g. SSE4.1)
+
 	PlnModelTreeBuilder();
 	PlnModule* buildModule(json& ast);
 };
@@ -13,7 +13,7 @@
 #include "PlnX86_64DataAllocator.h"
 #include "PlnX86_64Generator.h"
 
-inline int log2u(unsigned int x)
+inline int log2u(uint64_t x)
 {
 	int r = -1;
 	while (x) {
@@ -23,6 +23,101 @@ inline int log2u(unsigned int x)
 	return r;
 }
 
+inline bool isPow2(uint64_t x)
+{
+	return x && !(x & (x-1));
+}
+
+inline bool isImm32(int64_t i)
+{
+	return i >= -2147483648LL && i <= 2147483647LL;
+}
+
+static void pushMoveImm(PlnX86_64RegisterMachine &m, int64_t i, int regid)
+{
+	m.push(isImm32(i) ? MOVQ : MOVABSQ, imm(i), reg(regid));
+}
+
+// Multiplication by constant using lea/shift/add.
+// Each step costs 1 cycle, and is adopted only when the total cost
+// is less than the latency of imul. (3 steps was slower than imul
+// by samples/mulbench.pa)
+enum MulStepType {
+	MS_LEA,		// tgt + tgt*(val-1) -> tgt (val: 3,5,9)
+	MS_LEA_ORG,	// org + tgt*val -> tgt (val: 2,4,8)
+	MS_SHL,		// tgt << val -> tgt
+	MS_ADD_ORG,	// tgt + org -> tgt
+	MS_SUB_ORG,	// tgt - org -> tgt
+	MS_NEG		// -tgt -> tgt
+};
+
+struct MulStep {
+	MulStepType type;
+	int val;
+};
+
+static const int IMUL_COST = 3;
+
+static bool findMulSteps(int64_t n, vector<MulStep> &steps)
+{
+	static const int leas[] = {3, 5, 9};
+	static const int scales[] = {2, 4, 8};
+
+	uint64_t un = n < 0 ? -uint64_t(n) : n;
+	BOOST_ASSERT(un);
+
+	int shift_num = 0;
+	while (!(un & 1)) {
+		un >>= 1;
+		shift_num++;
+	}
+
+	// un is odd.
+	vector<MulStep> best;
+	bool found = false;
+	auto candidate = [&](vector<MulStep> cand) {
+		if (!found || cand.size() < best.size()) {
+			best = cand;
+			found = true;
+		}
+	};
+
+	if (un == 1)
+		candidate({});
+
+	for (int a: leas) {
+		if (un == a)
+			candidate({{MS_LEA, a}});
+		for (int b: leas)
+			if (un == uint64_t(a) * b)
+				candidate({{MS_LEA, a}, {MS_LEA, b}});
+		for (int s: scales)
+			if (un == 1 + uint64_t(s) * a)
+				candidate({{MS_LEA, a}, {MS_LEA_ORG, s}});
+	}
+
+	if (un > 3) {
+		if (isPow2(un-1))
+			candidate({{MS_SHL, log2u(un-1)}, {MS_ADD_ORG, 0}});
+		if (isPow2(un+1))
+			candidate({{MS_SHL, log2u(un+1)}, {MS_SUB_ORG, 0}});
+	}
+
+	if (!found)
+		return false;
+
+	if (shift_num)
+		best.push_back({MS_SHL, shift_num});
+	if (n < 0)
+		best.push_back({MS_NEG, 0});
+
+	if (best.size() >= IMUL_COST)
+		return false;
+
+	steps = best;
+	return true;
+}
+
 bool tryOptiMul(PlnX86_64RegisterMachine &m, PlnGenEntity* tgt, PlnGenEntity* scnd, string& comment)
 {
 	if (scnd->type != GA_CODE)
@@ -31,18 +126,193 @@ bool tryOptiMul(PlnX86_64RegisterMachine &m, PlnGenEntity* tgt, PlnGenEntity* sc
 	if (tgt->data_type == DT_FLOAT)
 		return false;
 
-	if (scnd->data_type == DT_UINT || scnd->data_type == DT_SINT) {
-		int64_t n = int64_of(scnd->ope);
-		int64_t mask = n-1;
-		if (n>0 && !(n&mask)) {	// Check if n == 2^x
-			BOOST_ASSERT(tgt->type == GA_REG);
-			int shift_num = log2u(n);
-			m.push(SALQ, imm(shift_num), ope(tgt), comment);
-			return true;
+	if (scnd->data_type != DT_UINT && scnd->data_type != DT_SINT)
+		return false;
 
+	BOOST_ASSERT(tgt->type == GA_REG);
+	int64_t n = int64_of(scnd->ope);
+	if (n == 0) {
+		m.push(XORQ, ope(tgt), ope(tgt), comment);
+		return true;
+	}
+
+	vector<MulStep> steps;
+	if (!findMulSteps(n, steps))
+		return false;
+
+	int t = regid_of(tgt);
+	for (auto &st: steps) {
+		if (st.type == MS_LEA_ORG || st.type == MS_ADD_ORG || st.type == MS_SUB_ORG) {
+			m.push(MOVQ, reg(t), reg(R11));
+			break;
 		}
 	}
-	return false;
+
+	for (int i=0; i<steps.size(); i++) {
+		auto &st = steps[i];
+		string cmt = (i == steps.size()-1) ? comment : "";
+		switch (st.type) {
+			case MS_LEA:
+				m.push(LEA, adrs(t, 0, t, st.val-1), reg(t), cmt);
+				break;
+			case MS_LEA_ORG:
+				m.push(LEA, adrs(R11, 0, t, st.val), reg(t), cmt);
+				break;
+			case MS_SHL:
+				m.push(SALQ, imm(st.val), reg(t), cmt);
+				break;
+			case MS_ADD_ORG:
+				m.push(ADDQ, reg(R11), reg(t), cmt);
+				break;
+			case MS_SUB_ORG:
+				m.push(SUBQ, reg(R11), reg(t), cmt);
+				break;
+			case MS_NEG:
+				m.push(NEGQ, reg(t), NULL, cmt);
+				break;
+		}
+	}
+
+	return true;
+}
+
+// Division by constant using multiply-high.
+// Magic numbers are calculated by the method of Hacker's Delight (10-9, 10-10).
+// All integers are extended to 64bit on register, so 64bit magic number
+// can be used for any integer size.
+struct DivMagic {
+	uint64_t magic;
+	int shift;
+	bool add;
+};
+
+static DivMagic getUDivMagic(uint64_t d)
+{
+	BOOST_ASSERT(!isPow2(d));
+	typedef unsigned __int128 uint128_t;
+	DivMagic dm;
+	int l = log2u(d);	// floor(log2(d))
+
+	uint128_t num = uint128_t(1) << (64+l);
+	uint64_t m = num / d;
+	uint64_t rem = num % d;
+
+	if ((d - rem) < (uint64_t(1) << l)) {
+		dm.add = false;
+	} else {
+		// 65bit magic number is required.
+		m += m;
+		uint64_t twice_rem = rem + rem;
+		if (twice_rem >= d || twice_rem < rem)
+			m += 1;
+		dm.add = true;
+	}
+	dm.magic = m + 1;
+	dm.shift = l;
+
+	return dm;
+}
+
+static DivMagic getSDivMagic(int64_t d)
+{
+	typedef unsigned __int128 uint128_t;
+	uint64_t absd = d < 0 ? -uint64_t(d) : d;
+	BOOST_ASSERT(!isPow2(absd));
+	DivMagic dm;
+	int l = log2u(absd);
+
+	uint128_t num = uint128_t(1) << (63+l);
+	uint64_t m = num / absd;
+	uint64_t rem = num % absd;
+
+	if ((absd - rem) < (uint64_t(1) << l)) {
+		dm.add = false;
+		dm.shift = l - 1;
+	} else {
+		m += m;
+		uint64_t twice_rem = rem + rem;
+		if (twice_rem >= absd || twice_rem < rem)
+			m += 1;
+		dm.add = true;
+		dm.shift = l;
+	}
+	m += 1;
+	dm.magic = d < 0 ? -m : m;
+
+	return dm;
+}
+
+// RAX: dividend -> RDX: quotient, R11: dividend
+static void genUDivByMagic(PlnX86_64RegisterMachine &m, uint64_t d)
+{
+	DivMagic dm = getUDivMagic(d);
+
+	m.push(MOVQ, reg(RAX), reg(R11));
+	pushMoveImm(m, dm.magic, RDX);
+	m.push(MULQ, reg(RDX));
+	if (dm.add) {
+		// q = (((n - hi) >> 1) + hi) >> shift
+		m.push(MOVQ, reg(R11), reg(RAX));
+		m.push(SUBQ, reg(RDX), reg(RAX));
+		m.push(SHRQ, imm(1), reg(RAX));
+		m.push(ADDQ, reg(RAX), reg(RDX));
+	}
+	if (dm.shift)
+		m.push(SHRQ, imm(dm.shift), reg(RDX));
+}
+
+// RAX: dividend -> RDX: quotient, R11: dividend
+static void genSDivByMagic(PlnX86_64RegisterMachine &m, int64_t d)
+{
+	DivMagic dm = getSDivMagic(d);
+
+	m.push(MOVQ, reg(RAX), reg(R11));
+	pushMoveImm(m, dm.magic, RDX);
+	m.push(IMULQ, reg(RDX));
+	if (dm.add)
+		m.push(d > 0 ? ADDQ : SUBQ, reg(R11), reg(RDX));
+	if (dm.shift)
+		m.push(SARQ, imm(dm.shift), reg(RDX));
+
+	// round toward zero: q += (q < 0)
+	m.push(MOVQ, reg(RDX), reg(RAX));
+	m.push(SHRQ, imm(63), reg(RAX));
+	m.push(ADDQ, reg(RAX), reg(RDX));
+}
+
+// RDX: quotient, R11: dividend -> RAX: remainder
+static void genRemainder(PlnX86_64RegisterMachine &m, int64_t d, string& comment)
+{
+	if (isImm32(d)) {
+		m.push(IMULQ, imm(d), reg(RDX));
+	} else {
+		m.push(MOVABSQ, imm(d), reg(RAX));
+		m.push(IMULQ, reg(RAX), reg(RDX));
+	}
+	m.push(MOVQ, reg(R11), reg(RAX));
+	m.push(SUBQ, reg(RDX), reg(RAX), comment);
+}
+
+// tgt + (tgt < 0 ? 2^shift_num-1 : 0) -> tgt, RDX: the bias.
+static void genSignedBias(PlnX86_64RegisterMachine &m, PlnGenEntity* tgt, int shift_num)
+{
+	m.push(MOVQ, ope(tgt), reg(RDX));
+	if (shift_num > 1)
+		m.push(SARQ, imm(63), reg(RDX));
+	m.push(SHRQ, imm(64-shift_num), reg(RDX));
+	m.push(ADDQ, reg(RDX), ope(tgt));
+}
+
+// Keep lower shift_num bits of tgt.
+static void genLowBitsMask(PlnX86_64RegisterMachine &m, PlnGenEntity* tgt, int shift_num, string& comment)
+{
+	int64_t mask = (shift_num == 64) ? -1 : (int64_t(1) << shift_num) - 1;
+	if (isImm32(mask)) {
+		m.push(ANDQ, imm(mask), ope(tgt), comment);
+	} else {
+		m.push(SALQ, imm(64-shift_num), ope(tgt));
+		m.push(SHRQ, imm(64-shift_num), ope(tgt), comment);
+	}
 }
 
 bool tryOptiDiv(PlnX86_64RegisterMachine &m, PlnGenEntity* tgt, PlnGenEntity* scnd, string& comment)
@@ -53,28 +323,49 @@ bool tryOptiDiv(PlnX86_64RegisterMachine &m, PlnGenEntity* tgt, PlnGenEntity* sc
 	if (tgt->data_type == DT_FLOAT)
 		return false;
 
-	if (scnd->data_type == DT_UINT || scnd->data_type == DT_SINT) {
-		int64_t n = int64_of(scnd->ope);
-		int64_t mask = n-1;
-		if (n>0 && !(n&mask)) {	// Check if n == 2^x
-			if (tgt->data_type == DT_UINT) {
-				BOOST_ASSERT(tgt->type == GA_REG);
-				int shift_num = log2u(n);
+	if (scnd->data_type != DT_UINT && scnd->data_type != DT_SINT)
+		return false;
+
+	int64_t n = int64_of(scnd->ope);
+	if (n == 0)	// Leave it to runtime error.
+		return false;
+
+	BOOST_ASSERT(tgt->type == GA_REG);
+
+	if (tgt->data_type == DT_UINT) {
+		uint64_t d = n;
+		if (isPow2(d)) {
+			int shift_num = log2u(d);
+			if (shift_num)
 				m.push(SHRQ, imm(shift_num), ope(tgt), comment);
-				return true;
-			} else {
-				BOOST_ASSERT(tgt->data_type == DT_SINT);
-				BOOST_ASSERT(tgt->size == 8);
-				int shift_num = log2u(n);
-				m.push(MOVQ, ope(tgt), reg(RDX));
-				m.push(SHRQ, imm(64-shift_num), ope(tgt));
-				m.push(ADDQ, reg(RDX), ope(tgt));
-				m.push(SARQ, imm(shift_num), ope(tgt));
-				return true;
-			}
+			return true;
 		}
+
+		BOOST_ASSERT(regid_of(tgt) == RAX);
+		genUDivByMagic(m, d);
+		m.push(MOVQ, reg(RDX), ope(tgt), comment);
+		return true;
 	}
-	return false;
+
+	BOOST_ASSERT(tgt->data_type == DT_SINT);
+	BOOST_ASSERT(tgt->size == 8);
+
+	uint64_t absd = n < 0 ? -uint64_t(n) : n;
+	if (isPow2(absd)) {
+		int shift_num = log2u(absd);
+		if (shift_num) {
+			genSignedBias(m, tgt, shift_num);
+			m.push(SARQ, imm(shift_num), ope(tgt), comment);
+		}
+		if (n < 0)
+			m.push(NEGQ, ope(tgt), NULL, comment);
+		return true;
+	}
+
+	BOOST_ASSERT(regid_of(tgt) == RAX);
+	genSDivByMagic(m, n);
+	m.push(MOVQ, reg(RDX), ope(tgt), comment);
+	return true;
 }
 
 
@@ -83,29 +374,47 @@ bool tryOptiMod(PlnX86_64RegisterMachine &m, PlnGenEntity* tgt, PlnGenEntity* sc
 	if (scnd->type != GA_CODE)
 		return false;
 	
-	if (scnd->data_type == DT_UINT || scnd->data_type == DT_SINT) {
-		int64_t n = int64_of(scnd->ope);
-		int64_t mask = n-1;
-		if (n>0 && !(n&mask)) {	// Check if n == 2^x
-			BOOST_ASSERT(tgt->type == GA_REG);
-			if (tgt->data_type == DT_UINT) {
-				m.push(ANDQ, imm(mask), ope(tgt), comment);
-				return true;
-
-			} else {
-				BOOST_ASSERT(tgt->data_type == DT_SINT);
-				BOOST_ASSERT(tgt->size == 8);
-				int shift_num = 64 - log2u(n);
-				m.push(CLTQ);
-				m.push(SHRQ, imm(shift_num), reg(RDX));
-				m.push(ADDQ, reg(RDX), ope(tgt));
-				m.push(ANDQ, imm(mask), ope(tgt), comment);
-				m.push(SUBQ, reg(RDX), ope(tgt));
-
-				return true;
-			}
+	if (scnd->data_type != DT_UINT && scnd->data_type != DT_SINT)
+		return false;
+
+	int64_t n = int64_of(scnd->ope);
+	if (n == 0)	// Leave it to runtime error.
+		return false;
+
+	BOOST_ASSERT(tgt->type == GA_REG);
+
+	if (tgt->data_type == DT_UINT) {
+		uint64_t d = n;
+		if (isPow2(d)) {
+			genLowBitsMask(m, tgt, log2u(d), comment);
+			return true;
+		}
+
+		BOOST_ASSERT(regid_of(tgt) == RAX);
+		genUDivByMagic(m, d);
+		genRemainder(m, n, comment);
+		return true;
+	}
+
+	BOOST_ASSERT(tgt->data_type == DT_SINT);
+	BOOST_ASSERT(tgt->size == 8);
+
+	uint64_t absd = n < 0 ? -uint64_t(n) : n;
+	if (isPow2(absd)) {
+		int shift_num = log2u(absd);
+		if (shift_num) {
+			// ((n + bias) & mask) - bias
+			genSignedBias(m, tgt, shift_num);
+			genLowBitsMask(m, tgt, shift_num, comment);
+			m.push(SUBQ, reg(RDX), ope(tgt));
+		} else {
+			m.push(XORQ, ope(tgt), ope(tgt), comment);
 		}
+		return true;
 	}
-	
-	return false;
+
+	BOOST_ASSERT(regid_of(tgt) == RAX);
+	genSDivByMagic(m, n);
+	genRemainder(m, n, comment);
+	return true;
 }
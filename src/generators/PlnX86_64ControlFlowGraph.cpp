@@ -0,0 +1,118 @@
+/// x86-64 (Linux) control flow graph of opecodes.
+///
+/// @file	PlnX86_64ControlFlowGraph.cpp
+/// @copyright	2022 YAMAGUCHI Toshinobu 
+
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <boost/assert.hpp>
+#include "../PlnModel.h"
+#include "PlnX86_64DataAllocator.h"
+#include "PlnX86_64Generator.h"
+#include "PlnX86_64RegisterMachineImp.h"
+#include "PlnX86_64ControlFlowGraph.h"
+
+inline bool isCondJump(PlnX86_64Mnemonic mne)
+{
+	return mne >= JA && mne <= JLE && mne != JMP;
+}
+
+PlnX86_64ControlFlowGraph::PlnX86_64ControlFlowGraph(vector<PlnOpeCode> &opecodes)
+{
+	// create basic blocks
+	bool in_block = false;
+	for (int i=0; i<opecodes.size(); i++) {
+		PlnOpeCode &opec = opecodes[i];
+		if (opec.mne == COMMENT || opec.mne == MNE_NONE)
+			continue;
+
+		if (opec.mne == LABEL) {
+			label_blocks[string_of(opec.src)] = blocks.size();
+			blocks.emplace_back(i);
+			in_block = true;
+			continue;
+		}
+
+		if (!in_block) {
+			blocks.emplace_back(i);
+			in_block = true;
+		}
+
+		PlnCFGBlock &b = blocks.back();
+		b.last = i;
+		if (opec.mne == RET) {
+			b.end_type = CFGE_Return;
+			in_block = false;
+
+		} else if (opec.mne == JMP) {
+			b.end_type = CFGE_Jump;
+			in_block = false;
+
+		} else if (isCondJump(opec.mne)) {
+			b.end_type = CFGE_JumpCond;
+			in_block = false;
+		}
+	}
+
+	// connect blocks
+	for (int i=0; i<blocks.size(); i++) {
+		PlnCFGBlock &b = blocks[i];
+		if (b.end_type == CFGE_Next || b.end_type == CFGE_JumpCond) {
+			BOOST_ASSERT(b.end_type == CFGE_Next || (i+1) < blocks.size());
+			if ((i+1) < blocks.size()) {
+				b.next_blocks.push_back(i+1);
+				blocks[i+1].previous_blocks.push_back(i);
+			}
+		}
+
+		if (b.end_type == CFGE_Jump || b.end_type == CFGE_JumpCond) {
+			auto lbl = label_blocks.find(string_of(opecodes[b.last].src));
+			if (lbl == label_blocks.end()) {	// Tail call to other function.
+				BOOST_ASSERT(b.end_type == CFGE_Jump);
+				continue;
+			}
+			b.next_blocks.push_back(lbl->second);
+			blocks[lbl->second].previous_blocks.push_back(i);
+		}
+	}
+}
+
+// Remove the blocks that can't be reached from the entry block.
+// Return the number of removed blocks.
+int PlnX86_64ControlFlowGraph::removeUnreachableBlocks(vector<PlnOpeCode> &opecodes)
+{
+	if (!blocks.size())
+		return 0;
+
+	vector<int> worklist = { 0 };
+	blocks[0].reachable = true;
+	while (worklist.size()) {
+		int bi = worklist.back();
+		worklist.pop_back();
+		for (int ni: blocks[bi].next_blocks) {
+			if (!blocks[ni].reachable) {
+				blocks[ni].reachable = true;
+				worklist.push_back(ni);
+			}
+		}
+	}
+
+	int removed = 0;
+	for (auto &b: blocks) {
+		if (b.reachable) {
+			auto &pblocks = b.previous_blocks;
+			pblocks.erase(remove_if(pblocks.begin(), pblocks.end(),
+					[this](int pi) { return !blocks[pi].reachable; }), pblocks.end());
+			continue;
+		}
+
+		for (int i=b.first; i<=b.last; i++)
+			opecodes[i].mne = MNE_NONE;
+		b.next_blocks.clear();
+		b.previous_blocks.clear();
+		removed++;
+	}
+
+	return removed;
+}
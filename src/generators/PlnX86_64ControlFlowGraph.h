@@ -0,0 +1,36 @@
+/// x86-64 (Linux) control flow graph of opecodes.
+///
+/// Basic blocks refer to opecodes by index and to other blocks by index.
+///
+/// @file	PlnX86_64ControlFlowGraph.h
+/// @copyright	2022 YAMAGUCHI Toshinobu 
+
+#include <unordered_map>
+
+enum CFGEndType {
+	CFGE_Next,
+	CFGE_Return,
+	CFGE_Jump,
+	CFGE_JumpCond,
+	CFGE_Merged,	// used by analysis that merges blocks.
+};
+
+class PlnCFGBlock {
+public:
+	int first, last;	// Index of first and last opecodes. (exclude comment)
+	CFGEndType end_type;
+	bool reachable;
+	vector<int> next_blocks;	// Fall-through block comes first.
+	vector<int> previous_blocks;
+
+	PlnCFGBlock(int first) : first(first), last(first), end_type(CFGE_Next), reachable(false) {}
+};
+
+class PlnX86_64ControlFlowGraph {
+public:
+	vector<PlnCFGBlock> blocks;
+	std::unordered_map<string, int> label_blocks;
+
+	PlnX86_64ControlFlowGraph(vector<PlnOpeCode> &opecodes);
+	int removeUnreachableBlocks(vector<PlnOpeCode> &opecodes);
+};
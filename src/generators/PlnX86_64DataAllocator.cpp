@@ -15,6 +15,8 @@
 
 using namespace std;
 static const int ARG_TBL[] = { RDI, RSI, RDX, RCX, R8, R9 };
+// Palan functions are never called from C. So they can use one more register.
+static const int PLN_ARG_TBL[] = { RDI, RSI, RDX, RCX, R8, R9, R10 };
 static const int FARG_TBL[] = { XMM0, XMM1, XMM2, XMM3, XMM4, XMM5, XMM6, XMM7 };
 static const int DSTRY_TBL[] = { RAX, RDI, RSI, RDX, RCX, R8, R9, R10, R11 };
 static const int FDSTRY_TBL[] = { XMM0, XMM1, XMM2, XMM3, XMM4, XMM5, XMM6, XMM7,
@@ -26,20 +28,17 @@ PlnX86_64DataAllocator::PlnX86_64DataAllocator()
 {
 }
 
-void PlnX86_64DataAllocator::destroyRegsByFuncCall()
+void PlnX86_64DataAllocator::destroyRegsByFuncCall(const vector<int>* destroy_regs)
 {
-	for (int regid: DSTRY_TBL) {
-		PlnDataPlace* pdp = regs[regid];
-		if (!pdp || (pdp->release_step != step)) {
-			PlnDataPlace* dp = new PlnDataPlace(8, DT_UNKNOWN);
-			dp->type = DP_REG;
-			dp->status = DS_RELEASED;
-			dp->alloc_step = dp->release_step = step;
-			dp->previous = pdp;
-			regs[regid] = dp;
-		}
+	vector<int> regids;
+	if (destroy_regs) {
+		regids = *destroy_regs;
+	} else {
+		regids.assign(begin(DSTRY_TBL), end(DSTRY_TBL));
+		regids.insert(regids.end(), begin(FDSTRY_TBL), end(FDSTRY_TBL));
 	}
-	for (int regid: FDSTRY_TBL) {
+
+	for (int regid: regids) {
 		PlnDataPlace* pdp = regs[regid];
 		if (!pdp || (pdp->release_step != step)) {
 			PlnDataPlace* dp = new PlnDataPlace(8, DT_UNKNOWN);
@@ -57,13 +56,41 @@ void PlnX86_64DataAllocator::setArgDps(int func_type, vector<PlnDataPlace*> &arg
 	int reg_ind = 0;
 	int freg_ind = 0;
 	int stk_ind = 0;
+	int stk_parts = 0;
+
+	const int* arg_tbl = ARG_TBL;
+	int arg_num = 6;
+	if (func_type == FT_PLN) {
+		arg_tbl = PLN_ARG_TBL;
+		arg_num = 7;
+	} else if (func_type == FT_SYS) {
+		arg_tbl = SYSARG_TBL;
+	} else
+		BOOST_ASSERT(func_type == FT_C);
 	
 	for (int index = 0; index < arg_dps.size(); index++) {
 		PlnDataPlace* dp = arg_dps[index];
 		static string comment = "arg";
 		dp->comment = &comment;
 
-		if (dp->data_type == DT_FLOAT && freg_ind <= 7) {
+		if (dp->struct_parts > 1) {
+			// The struct is passed on the stack when all parts can't be in registers.
+			int regs = 0, fregs = 0;
+			for (int i = index; i < index + dp->struct_parts; i++) {
+				if (arg_dps[i]->data_type == DT_FLOAT) fregs++;
+				else regs++;
+			}
+			if (reg_ind + regs > arg_num || freg_ind + fregs > 8)
+				stk_parts = dp->struct_parts;
+		}
+
+		bool to_stack = false;
+		if (stk_parts) {
+			stk_parts--;
+			to_stack = true;
+		}
+
+		if (!to_stack && dp->data_type == DT_FLOAT && freg_ind <= 7) {
 			int regid;
 			dp->type = DP_REG;
 			dp->data.reg.id = FARG_TBL[freg_ind];
@@ -71,22 +98,14 @@ void PlnX86_64DataAllocator::setArgDps(int func_type, vector<PlnDataPlace*> &arg
 
 			freg_ind++;
 
-		} else if (dp->data_type != DT_FLOAT && reg_ind <= 5) {
-			int regid;
-			if (func_type == FT_PLN || func_type == FT_C)
-				regid = ARG_TBL[reg_ind];
-			else if (func_type == FT_SYS)
-				regid = SYSARG_TBL[reg_ind];
-			else
-				BOOST_ASSERT(false);
-
+		} else if (!to_stack && dp->data_type != DT_FLOAT && reg_ind < arg_num) {
 			dp->type = DP_REG;
-			dp->data.reg.id = regid;
+			dp->data.reg.id = arg_tbl[reg_ind];
 			dp->data.reg.offset = 0;
 
 			reg_ind++;
 
-		} else {	// index >= 5
+		} else {
 			if (is_callee) {
 				dp->type = DP_STK_BP;
 				dp->data.stack.idx = stk_ind;
@@ -107,6 +126,24 @@ void PlnX86_64DataAllocator::setRetValDps(int func_type, vector<PlnDataPlace*> &
 {
 	static string comment = "retval";
 
+	if (func_type == FT_C && retval_dps.size() && retval_dps[0]->struct_parts) {
+		// Small struct: RAX, RDX for integer parts and XMM0, XMM1 for float parts.
+		static const int RET_TBL[] = { RAX, RDX };
+		int reg_ind = 0;
+		int freg_ind = 0;
+		for (auto dp: retval_dps) {
+			dp->type = DP_REG;
+			if (dp->data_type == DT_FLOAT)
+				dp->data.reg.id = FARG_TBL[freg_ind++];
+			else
+				dp->data.reg.id = RET_TBL[reg_ind++];
+			dp->data.reg.offset = 0;
+			dp->comment = &comment;
+			dp->custom_inf |= IS_RETVAL;
+		}
+		return;
+	}
+
 	if (retval_dps.size() == 1 && retval_dps[0]->data_type != DT_FLOAT) {
 		PlnDataPlace* dp = retval_dps[0];
 		dp->type = DP_REG;
@@ -133,7 +170,7 @@ static void checkExistsActiveDP(PlnDataPlace* root, PlnDataPlace* dp)
 	}
 }
 
-void PlnX86_64DataAllocator::funcCalled(vector<PlnDataPlace*>& args, int func_type, bool never_return)
+void PlnX86_64DataAllocator::funcCalled(vector<PlnDataPlace*>& args, int func_type, bool never_return, const vector<int>* destroy_regs)
 {
 	// TODO: use popSrc().
 	for (auto dp: args) {
@@ -152,7 +189,7 @@ void PlnX86_64DataAllocator::funcCalled(vector<PlnDataPlace*>& args, int func_ty
 	}
 
 	if (!never_return)
-		destroyRegsByFuncCall();
+		destroyRegsByFuncCall(destroy_regs);
 	step++;
 }
 
@@ -564,6 +601,8 @@ void PlnX86_64DataAllocator::optimizeRegAlloc()
 					break;
 				}
 			}
+			if (regid == -1 && use_rbp && !regs[RBPG])
+				regid = RBPG;
 		}
 
 		if (regid == -1) return;
@@ -10,6 +10,7 @@ enum {
 	RDI, RSI, RBP, RSP,
 	R8, R9, R10, R11,
 	R12, R13, R14, R15,
+	RBPG,	// RBP as general register. Available when frame pointer is omitted.
 	XMM0, XMM1, XMM2, XMM3,
 	XMM4, XMM5, XMM6, XMM7,
 	XMM8, XMM9, XMM10, XMM11,
@@ -23,7 +24,7 @@ enum {	// for custom_inf
 
 class PlnX86_64DataAllocator: public PlnDataAllocator
 {
-	void destroyRegsByFuncCall();
+	void destroyRegsByFuncCall(const vector<int>* destroy_regs);
 	bool tryMoveDp2Reg(PlnDataPlace* dp, int regid);
 
 protected:
@@ -31,9 +32,11 @@ protected:
 	void setRetValDps(int func_type, vector<PlnDataPlace*> &retval_dps, bool is_callee);
 
 public:
+	bool use_rbp = false;	// RBP is allocatable. (Frame pointer is omitted)
+
 	PlnX86_64DataAllocator();
 
-	void funcCalled(vector<PlnDataPlace*>& args, int func_type, bool never_return) override;
+	void funcCalled(vector<PlnDataPlace*>& args, int func_type, bool never_return, const vector<int>* destroy_regs = NULL) override;
 
 	void prepareMemCopyDps(PlnDataPlace* &dst, PlnDataPlace* &src, PlnDataPlace* &len) override;
 	void memCopyed(PlnDataPlace* dst, PlnDataPlace* src, PlnDataPlace* len) override;
@@ -9,6 +9,8 @@
 #include <string.h>
 #include <stdio.h>
 #include <sstream>
+#include <algorithm>
+#include <cpuid.h>
 #include <boost/assert.hpp>
 #include <boost/algorithm/string.hpp>
 #include "../PlnModel.h"
@@ -57,10 +59,40 @@ static bool opecmp(const PlnOperandInfo *l, const PlnOperandInfo *r)
 // LCOV_EXCL_STOP
 
 PlnX86_64Generator::PlnX86_64Generator(ostream& ostrm)
-	: PlnGenerator(ostrm), require_align(false), max_const_id(0), func_stack_size(0)
+	: PlnGenerator(ostrm), require_align(false), max_const_id(0), func_stack_size(0),
+	  cpu_features(CPUF_SSE2), omit_frame_pointer(false)
 {
 }
 
+// x86-64 micro-architecture levels of System V ABI and the running CPU.
+int PlnX86_64Generator::getCPUFeatures(const string& arch)
+{
+	const int v2 = CPUF_SSE2 | CPUF_SSE41 | CPUF_POPCNT;
+	const int v3 = v2 | CPUF_AVX | CPUF_AVX2 | CPUF_LZCNT | CPUF_BMI1 | CPUF_BMI2 | CPUF_FMA;
+
+	if (arch == "x86-64") return CPUF_SSE2;
+	if (arch == "x86-64-v2") return v2;
+	if (arch == "x86-64-v3") return v3;
+	if (arch == "native") {
+		__builtin_cpu_init();
+		int features = CPUF_SSE2;
+		if (__builtin_cpu_supports("sse4.1")) features |= CPUF_SSE41;
+		if (__builtin_cpu_supports("popcnt")) features |= CPUF_POPCNT;
+		if (__builtin_cpu_supports("avx")) features |= CPUF_AVX;
+		if (__builtin_cpu_supports("avx2")) features |= CPUF_AVX2;
+		if (__builtin_cpu_supports("bmi")) features |= CPUF_BMI1;
+		if (__builtin_cpu_supports("bmi2")) features |= CPUF_BMI2;
+		if (__builtin_cpu_supports("fma")) features |= CPUF_FMA;
+
+		unsigned int eax, ebx, ecx, edx;
+		if (__get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx) && (ecx & bit_LZCNT))
+			features |= CPUF_LZCNT;
+		return features;
+	}
+
+	return -1;
+}
+
 PlnX86_64Generator::~PlnX86_64Generator()
 {
 	for (ConstInfo& ci: const_buf) {
@@ -297,12 +329,17 @@ void PlnX86_64Generator::genLocalVarArea(int size)
 
 	func_stack_size = size;
 	m.push(SUBQ, imm(size), reg(RSP));
-	m.reserve(5);	// for reg save
+	m.reserve(6);	// for reg save
+}
+
+bool PlnX86_64Generator::getDestroyRegs(const string& func_name, vector<int>& regids)
+{
+	return m.getDestroyRegs(func_name, regids);
 }
 
 void PlnX86_64Generator::genEndFunc()
 {
-	m.popOpecodes(os);
+	m.popOpecodes(os, cpu_features & CPUF_AVX, omit_frame_pointer);
 
 	int alignment = 1;
 	for (ConstInfo &ci: const_buf) {
@@ -342,6 +379,111 @@ void PlnX86_64Generator::genEndFunc()
 	}
 }
 
+// Pool allocator runtime that replaces malloc/free of objects.
+// Block: | size class (8) | next free block (8) | object data ... |
+// Size class is a count of 16 bytes including the 16 bytes header.
+// The blocks of small class are reused by the free list of each class.
+// Note: The block is not compatible with malloc/free of C.
+//  The object must not be passed to C code that frees it,
+//  and the memory allocated by C must not be freed by palan.
+void PlnX86_64Generator::genPoolAllocator(bool with_stats)
+{
+	const int class_num = 32;	// Max pooled block: 496 bytes
+
+	os << "# pool allocator" << endl;
+	os << "	.data" << endl;
+	os << "	.balign 8" << endl;
+	os << "	.weak __pln_alloc_count, __pln_free_count, __pln_pool_hit_count, __pln_free_lists" << endl;
+	os << "__pln_alloc_count:" << endl;
+	os << "	.quad 0" << endl;
+	os << "__pln_free_count:" << endl;
+	os << "	.quad 0" << endl;
+	os << "__pln_pool_hit_count:" << endl;
+	os << "	.quad 0" << endl;
+	os << "__pln_free_lists:" << endl;
+	os << "	.zero " << class_num*8 << endl;
+	os << "	.text" << endl;
+
+	// void* __pln_alloc(uint64 size)
+	os << "	.weak __pln_alloc" << endl;
+	os << "	.balign 16" << endl;
+	os << "__pln_alloc:" << endl;
+	if (with_stats) {
+		// Register statistics output at the first allocation.
+		os << "	cmpq $0, __pln_alloc_count(%rip)" << endl;
+		os << "	jne .Lpln_alloc_start" << endl;
+		os << "	pushq %rdi" << endl;
+		os << "	movq $__pln_alloc_stats, %rdi" << endl;
+		os << "	xorq %rsi, %rsi" << endl;
+		os << "	xorq %rdx, %rdx" << endl;
+		os << "	call __cxa_atexit" << endl;
+		os << "	popq %rdi" << endl;
+		os << ".Lpln_alloc_start:" << endl;
+	}
+	os << "	incq __pln_alloc_count(%rip)" << endl;
+	os << "	leaq 31(%rdi), %rax" << endl;
+	os << "	shrq $4, %rax	# size class" << endl;
+	os << "	cmpq $" << class_num << ", %rax" << endl;
+	os << "	jae .Lpln_alloc_new" << endl;
+	os << "	leaq __pln_free_lists(%rip), %rcx" << endl;
+	os << "	movq (%rcx,%rax,8), %rdx" << endl;
+	os << "	testq %rdx, %rdx" << endl;
+	os << "	je .Lpln_alloc_new" << endl;
+	os << "	movq 8(%rdx), %rsi" << endl;
+	os << "	movq %rsi, (%rcx,%rax,8)" << endl;
+	os << "	incq __pln_pool_hit_count(%rip)" << endl;
+	os << "	leaq 16(%rdx), %rax" << endl;
+	os << "	ret" << endl;
+	os << ".Lpln_alloc_new:" << endl;
+	os << "	pushq %rax" << endl;
+	os << "	movq %rax, %rdi" << endl;
+	os << "	salq $4, %rdi" << endl;
+	os << "	call malloc" << endl;
+	os << "	popq %rcx" << endl;
+	os << "	movq %rcx, (%rax)" << endl;
+	os << "	addq $16, %rax" << endl;
+	os << "	ret" << endl;
+
+	// void __pln_free(void* ptr)
+	os << "	.weak __pln_free" << endl;
+	os << "	.balign 16" << endl;
+	os << "__pln_free:" << endl;
+	os << "	testq %rdi, %rdi" << endl;
+	os << "	je .Lpln_free_end" << endl;
+	os << "	incq __pln_free_count(%rip)" << endl;
+	os << "	subq $16, %rdi" << endl;
+	os << "	movq (%rdi), %rax	# size class" << endl;
+	os << "	cmpq $" << class_num << ", %rax" << endl;
+	os << "	jae .Lpln_free_large" << endl;
+	os << "	leaq __pln_free_lists(%rip), %rcx" << endl;
+	os << "	movq (%rcx,%rax,8), %rdx" << endl;
+	os << "	movq %rdx, 8(%rdi)" << endl;
+	os << "	movq %rdi, (%rcx,%rax,8)" << endl;
+	os << ".Lpln_free_end:" << endl;
+	os << "	ret" << endl;
+	os << ".Lpln_free_large:" << endl;
+	os << "	jmp free" << endl;
+
+	if (with_stats) {
+		os << "	.balign 16" << endl;
+		os << "__pln_alloc_stats:" << endl;
+		os << "	subq $8, %rsp" << endl;
+		os << "	movq $2, %rdi" << endl;
+		os << "	movq $.Lpln_stats_fmt, %rsi" << endl;
+		os << "	movq __pln_alloc_count(%rip), %rdx" << endl;
+		os << "	movq __pln_free_count(%rip), %rcx" << endl;
+		os << "	movq __pln_pool_hit_count(%rip), %r8" << endl;
+		os << "	xorq %rax, %rax" << endl;
+		os << "	call dprintf" << endl;
+		os << "	addq $8, %rsp" << endl;
+		os << "	ret" << endl;
+		os << "	.section .rodata" << endl;
+		os << ".Lpln_stats_fmt:" << endl;
+		os << "	.string \"alloc: %ld, free: %ld, pool hit: %ld\\n\"" << endl;
+		os << "	.text" << endl;
+	}
+}
+
 void PlnX86_64Generator::genCCall(string& cfuncname, vector<int> &arg_dtypes, bool has_va_arg)
 {
 	if (has_va_arg) {
@@ -370,7 +512,7 @@ void PlnX86_64Generator::genSysCall(int id, const string& comment)
 void PlnX86_64Generator::genReturn()
 {
 	m.push(ADDQ, imm(func_stack_size), reg(RSP));
-	m.reserve(5);	// for reg load
+	m.reserve(6);	// for reg load
 	m.push(POPQ, reg(RBP));	
 	m.push(RET);
 }
@@ -807,7 +949,10 @@ static int setMove2GenInfo(int pattern, GenInfo genInfos[3])
 			genInfos[2] = {MOVSS};
 			return 3;
 		case SREGF|S8 + DREGF|D4:
-			BOOST_ASSERT(false);
+			genInfos[0] = {MOVQ, XMM11};
+			genInfos[1] = {CVTSD2SS, XMM11};
+			genInfos[2] = {MOVQ};
+			return 3;
 
 		// 1. reg4f->xmm8f: MOVQ(X11) + CVTSS2SD 
 		// 2. reg4f->mem8f: MOVQ(X11) + CVTSS2SD(X11) + MOVSD
@@ -1286,12 +1431,15 @@ static int setNumCalc2GenInfo(CalcOperation calc, int pattern, GenInfo genInfos[
 		//    xmm4f + mem4f: MOVQ(X11) + ADDSS
 		// 6. xmm8f + reg4f: MOVQ(X11) + CVTSS2SD(X11) + ADDSD
 		// 7. xmm4f + mem4f: ADDSS
+		//    xmm4f + xmm4f: ADDSS
 		case DXMMF|D8 + SXMMF|S8:	// 1
-		case DXMMF|D8 + SXMMF|S4:	// 2
-			BOOST_ASSERT(false);
 		case DXMMF|D8 + SMEMF|S8:	// 3
 			genInfos[0] = {mne};
 			return 1;
+		case DXMMF|D8 + SXMMF|S4:	// 2
+			genInfos[0] = {CVTSS2SD, XMM11};
+			genInfos[1] = {mne};
+			return 2;
 		case DXMMF|D8 + SMEMF|S4:	// 4
 			genInfos[0] = {MOVSS, XMM11};
 			genInfos[1] = {CVTSS2SD, XMM11};
@@ -1308,6 +1456,7 @@ static int setNumCalc2GenInfo(CalcOperation calc, int pattern, GenInfo genInfos[
 			genInfos[2] = {mne};
 			return 3;
 		case DXMMF|D4 + SMEMF|S4:	// 7
+		case DXMMF|D4 + SXMMF|S4:
 			genInfos[0] = {mne};
 			return 1;
 
@@ -1663,6 +1812,55 @@ static int setCmp2GenInfo(int pattern, GenInfo genInfos[3], int &cmp_type)
 			genInfos[0] = {movUintMemToMne[srcByte(pattern)], R11};
 			genInfos[1] = {CMP};
 			n = 2; break;
+
+	// integer(memory) == integer
+		// Note: 1st memory should be 8 byte.
+		// 1. mem8i == immi: CMPQ
+		// 2. mem8i == bigimmi: MOVABSQ(R11) + CMP
+		// 3. mem8i == regNi: CMP
+		// 4. mem8i == memNi: MOVn(R11) + CMP
+		// 1.
+		case DMEMI + SIMMI: case DMEMI + SIMMU:
+		case DMEMU + SIMMI: 
+			genInfos[0] = {CMPQ};
+			return 1;
+		case DMEMU + SIMMU:
+			genInfos[0] = {CMPQ};
+			n = 1; break;
+
+		// 2
+		case DMEMI + SBIGIMMI: case DMEMI + SBIGIMMU:
+		case DMEMU + SBIGIMMI:
+			genInfos[0] = {MOVABSQ, R11};
+			genInfos[1] = {CMP};
+			return 2;
+		case DMEMU + SBIGIMMU:
+			genInfos[0] = {MOVABSQ, R11};
+			genInfos[1] = {CMP};
+			n = 2; break;
+
+		// 3
+		case DMEMI + SREGI: case DMEMI + SREGU:
+		case DMEMU + SREGI:
+			genInfos[0] = {CMP};
+			return 1;
+		 case DMEMU + SREGU:
+			genInfos[0] = {CMP};
+			n = 1; break;
+
+		// 4
+		case DMEMI + SMEMI: case DMEMU + SMEMI:
+			genInfos[0] = {movSintMemToMne[srcByte(pattern)], R11};
+			genInfos[1] = {CMP};
+			return 2;
+		case DMEMI + SMEMU:
+			genInfos[0] = {movUintMemToMne[srcByte(pattern)], R11};
+			genInfos[1] = {CMP};
+			return 2;
+		case DMEMU + SMEMU:
+			genInfos[0] = {movUintMemToMne[srcByte(pattern)], R11};
+			genInfos[1] = {CMP};
+			n = 2; break;
 		default: BOOST_ASSERT(false);
 	}
 
@@ -1679,6 +1877,7 @@ static int setCmp2GenInfo(int pattern, GenInfo genInfos[3], int &cmp_type)
 
 int PlnX86_64Generator::genCmp(PlnGenEntity* first, PlnGenEntity* second, int cmp_type, string comment)
 {
+	BOOST_ASSERT(first->type == GA_REG || first->size == 8);
 	int pattern = getOpePattern(first, second);
 	GenInfo genInfo[3];
 	int n = setCmp2GenInfo(pattern, genInfo, cmp_type);
@@ -1710,18 +1909,362 @@ int PlnX86_64Generator::genMoveCmpFlag(PlnGenEntity* tgt, int cmp_type, string c
 	
 	m.push(setcmd, reg(regid_of(tgt),1), NULL, comment);
 	m.push(MOVZBQ, reg(regid_of(tgt),1), ope(tgt));
+
+	return cmp_type;
+}
+
+void PlnX86_64Generator::genCondMove(PlnGenEntity* tgt, PlnGenEntity* src, int cmp_type, string comment)
+{
+	BOOST_ASSERT(tgt->type == GA_REG);
+	BOOST_ASSERT(tgt->size == 8);
+	BOOST_ASSERT(tgt->data_type != DT_FLOAT && src->data_type != DT_FLOAT);
+
+	PlnX86_64Mnemonic cmovcmd =
+		cmp_type == CMP_EQ ? CMOVE:
+		cmp_type == CMP_NE ? CMOVNE:
+		cmp_type == CMP_L ? CMOVL:
+		cmp_type == CMP_G ? CMOVG:
+		cmp_type == CMP_LE ? CMOVLE:
+		cmp_type == CMP_GE ? CMOVGE:
+		cmp_type == CMP_B ? CMOVB:
+		cmp_type == CMP_A ? CMOVA:
+		cmp_type == CMP_BE ? CMOVBE:
+		cmp_type == CMP_AE ? CMOVAE:
+		COMMENT;
+
+	BOOST_ASSERT(cmovcmd != COMMENT);
+
+	if (src->type == GA_CODE || src->size != 8) {
+		// cmov can't use immediate and needs same size operand.
+		// Note: mov doesn't change the flags.
+		PlnGenEntity tmp;
+		tmp.type = GA_REG;
+		tmp.data_type = src->data_type;
+		tmp.size = 8;
+		tmp.ope = reg(R11);
+		genMove(&tmp, src, "");
+		m.push(cmovcmd, reg(R11), ope(tgt), comment);
+
+	} else {
+		m.push(cmovcmd, ope(src), ope(tgt), comment);
+	}
+}
+
+void PlnX86_64Generator::genMinMax(PlnGenEntity* tgt, PlnGenEntity* second, bool is_min, string comment)
+{
+	BOOST_ASSERT(tgt->type == GA_REG);
+	BOOST_ASSERT(tgt->data_type == DT_FLOAT && second->data_type == DT_FLOAT);
+	BOOST_ASSERT(second->type == GA_REG || second->type == GA_MEM);
+	BOOST_ASSERT(tgt->size == second->size);
+
+	PlnX86_64Mnemonic mne;
+	if (tgt->size == 8) mne = is_min ? MINSD : MAXSD;
+	else {
+		BOOST_ASSERT(tgt->size == 4);
+		mne = is_min ? MINSS : MAXSS;
+	}
+
+	if (second->type == GA_REG && regid_of(second) < XMM0) {
+		// float value on general register.
+		m.push(MOVQ, reg(regid_of(second)), reg(XMM11));
+		m.push(mne, reg(XMM11), ope(tgt), comment);
+
+	} else {
+		m.push(mne, ope(second), ope(tgt), comment);
+	}
+}
+
+void PlnX86_64Generator::genIntrinsic(int intrinsic, PlnGenEntity* tgt, PlnGenEntity* second, string comment)
+{
+	BOOST_ASSERT(tgt->type == GA_REG && regid_of(tgt) >= XMM0);
+	BOOST_ASSERT(tgt->data_type == DT_FLOAT);
+	bool is_dbl = tgt->size == 8;
+	BOOST_ASSERT(is_dbl || tgt->size == 4);
+
+	switch (intrinsic) {
+		case IN_SQRT:
+			m.push(is_dbl ? SQRTSD : SQRTSS, ope(tgt), ope(tgt), comment);
+			break;
+
+		case IN_FABS:
+			// Clear the sign bit.
+			if (is_dbl) m.push(MOVABSQ, imm(0x7fffffffffffffff), reg(R11));
+			else m.push(MOVQ, imm(0x7fffffff), reg(R11));
+			m.push(MOVQ, reg(R11), reg(XMM11));
+			m.push(is_dbl ? ANDPD : ANDPS, reg(XMM11), ope(tgt), comment);
+			break;
+
+		case IN_FMIN:
+		case IN_FMAX:
+		{
+			// minsd returns the second operand when either is NaN,
+			// but fmin returns the other when one is NaN.
+			// XMM12: y, XMM11: min(y, x) (x when NaN), tgt: x is NaN ? y : XMM11
+			BOOST_ASSERT(second && second->data_type == DT_FLOAT && second->size == tgt->size);
+			BOOST_ASSERT(second->type == GA_REG || second->type == GA_MEM);
+			PlnX86_64Mnemonic mne;
+			if (intrinsic == IN_FMIN) mne = is_dbl ? MINSD : MINSS;
+			else mne = is_dbl ? MAXSD : MAXSS;
+
+			if (second->type == GA_REG && regid_of(second) < XMM0)
+				m.push(MOVQ, reg(regid_of(second)), reg(XMM12));
+			else
+				m.push(is_dbl ? MOVSD : MOVSS, ope(second), reg(XMM12));
+			m.push(is_dbl ? MOVSD : MOVSS, reg(XMM12), reg(XMM11));
+			m.push(mne, ope(tgt), reg(XMM11));
+			m.push(is_dbl ? CMPUNORDSD : CMPUNORDSS, ope(tgt), ope(tgt));
+			m.push(is_dbl ? ANDPD : ANDPS, ope(tgt), reg(XMM12));
+			m.push(is_dbl ? ANDNPD : ANDNPS, reg(XMM11), ope(tgt));
+			m.push(is_dbl ? ORPD : ORPS, reg(XMM12), ope(tgt), comment);
+			break;
+		}
+
+		case IN_FLOOR:
+		case IN_CEIL:
+		{
+			BOOST_ASSERT(cpu_features & CPUF_SSE41);
+			// 0x8: Suppress precision exception, 0x1: toward -inf, 0x2: toward +inf
+			int mode = (intrinsic == IN_FLOOR) ? 0x9 : 0xa;
+			m.push(is_dbl ? ROUNDSD : ROUNDSS, imm(mode), ope(tgt), comment);
+			break;
+		}
+
+		default:
+			BOOST_ASSERT(false);
+	}
+}
+
+static void zeroExtend(PlnX86_64RegisterMachine& m, int regid, int size)
+{
+	if (size == 4) m.push(MOVL, reg(regid, 4), reg(regid, 4));
+	else if (size == 2) m.push(MOVZWQ, reg(regid, 2), reg(regid));
+	else if (size == 1) m.push(MOVZBQ, reg(regid, 1), reg(regid));
+}
+
+static void signExtend(PlnX86_64RegisterMachine& m, int regid, int size)
+{
+	if (size == 4) m.push(MOVSLQ, reg(regid, 4), reg(regid));
+	else if (size == 2) m.push(MOVSWQ, reg(regid, 2), reg(regid));
+	else if (size == 1) m.push(MOVSBQ, reg(regid, 1), reg(regid));
+}
+
+// size: the bytes of the operand. The result is extended to 8 bytes.
+void PlnX86_64Generator::genBitIntrinsic(int intrinsic, int size, PlnGenEntity* tgt, PlnGenEntity* second, string comment)
+{
+	BOOST_ASSERT(tgt->type == GA_REG && tgt->size == 8);
+	BOOST_ASSERT(tgt->data_type == DT_SINT || tgt->data_type == DT_UINT);
+	BOOST_ASSERT(size == 1 || size == 2 || size == 4 || size == 8);
+	int r = regid_of(tgt);
+	int bits = size * 8;
+	BOOST_ASSERT(r != RCX && r != R11);
+
+	switch (intrinsic) {
+		case IN_POPCOUNT:
+			zeroExtend(m, r, size);
+			if (cpu_features & CPUF_POPCNT) {
+				m.push(POPCNTQ, reg(r), reg(r), comment);
+
+			} else {
+				// Count by bit-parallel addition. Use RDX(or RCX) as the work.
+				int w = (r == RDX) ? RCX : RDX;
+				m.push(MOVQ, reg(w), reg(XMM12));
+				m.push(MOVABSQ, imm(0x5555555555555555), reg(w));
+				m.push(MOVQ, reg(r), reg(R11));
+				m.push(SHRQ, imm(1), reg(R11));
+				m.push(ANDQ, reg(w), reg(R11));
+				m.push(SUBQ, reg(R11), reg(r));	// 2 bits count
+				m.push(MOVABSQ, imm(0x3333333333333333), reg(w));
+				m.push(MOVQ, reg(r), reg(R11));
+				m.push(SHRQ, imm(2), reg(R11));
+				m.push(ANDQ, reg(w), reg(R11));
+				m.push(ANDQ, reg(w), reg(r));
+				m.push(ADDQ, reg(R11), reg(r));	// 4 bits count
+				m.push(MOVQ, reg(r), reg(R11));
+				m.push(SHRQ, imm(4), reg(R11));
+				m.push(ADDQ, reg(R11), reg(r));
+				m.push(MOVABSQ, imm(0x0f0f0f0f0f0f0f0f), reg(w));
+				m.push(ANDQ, reg(w), reg(r));	// 8 bits count
+				m.push(MOVABSQ, imm(0x0101010101010101), reg(w));
+				m.push(IMULQ, reg(w), reg(r));
+				m.push(SHRQ, imm(56), reg(r));	// sum of all bytes
+				m.push(MOVQ, reg(XMM12), reg(w), comment);
+			}
+			break;
+
+		case IN_CLZ:
+			zeroExtend(m, r, size);
+			if (cpu_features & CPUF_LZCNT) {
+				m.push(LZCNTQ, reg(r), reg(r), comment);
+				if (size < 8)
+					m.push(SUBQ, imm(64 - bits), reg(r));
+			} else {
+				// (bits-1) - bsr(x),  bsr(0) => -1
+				m.push(MOVQ, imm(-1), reg(R11));
+				m.push(BSRQ, reg(r), reg(r));
+				m.push(CMOVE, reg(R11), reg(r));
+				m.push(NEGQ, reg(r));
+				m.push(ADDQ, imm(bits - 1), reg(r), comment);
+			}
+			break;
+
+		case IN_CTZ:
+			zeroExtend(m, r, size);
+			// Set the stopper bit. ctz(0) => bits
+			if (size < 8)
+				m.push(BTSQ, imm(bits), reg(r));
+			if (cpu_features & CPUF_BMI1) {
+				m.push(TZCNTQ, reg(r), reg(r), comment);
+			} else {
+				m.push(BSFQ, reg(r), reg(r), comment);
+				if (size == 8) {
+					m.push(MOVQ, imm(64), reg(R11));
+					m.push(CMOVE, reg(R11), reg(r));
+				}
+			}
+			break;
+
+		case IN_BSWAP:
+			if (size == 8) m.push(BSWAPQ, reg(r), NULL, comment);
+			else if (size == 4) m.push(BSWAPL, reg(r, 4), NULL, comment);
+			else if (size == 2) m.push(ROLW, imm(8), reg(r, 2), comment);
+			break;
+
+		case IN_ROTL:
+		case IN_ROTR:
+		{
+			BOOST_ASSERT(second);
+			bool is_left = intrinsic == IN_ROTL;
+			static const PlnX86_64Mnemonic rol_mnes[4] = { ROLB, ROLW, ROLL, ROLQ };
+			static const PlnX86_64Mnemonic ror_mnes[4] = { RORB, RORW, RORL, RORQ };
+			int si = size == 8 ? 3 : size == 4 ? 2 : size == 2 ? 1 : 0;
+			PlnX86_64Mnemonic mne = is_left ? rol_mnes[si] : ror_mnes[si];
+
+			if (second->type == GA_CODE) {
+				int n = int64_of(second->ope) & (bits - 1);
+				if ((cpu_features & CPUF_BMI2) && size >= 4) {
+					// rorx doesn't change the flags.
+					if (is_left) n = (bits - n) & (bits - 1);
+					m.push(size == 8 ? RORXQ : RORXL, imm(n), reg(r, size), comment);
+				} else {
+					m.push(mne, imm(n), reg(r, size), comment);
+				}
+
+			} else {
+				// The count should be on CL.
+				PlnGenEntity cnt;
+				cnt.type = GA_REG;
+				cnt.data_type = second->data_type;
+				cnt.size = 8;
+				cnt.ope = reg(RCX);
+				m.push(MOVQ, reg(RCX), reg(R11));
+				genMove(&cnt, second, "");
+				m.push(mne, reg(RCX, 1), reg(r, size), comment);
+				m.push(MOVQ, reg(R11), reg(RCX));
+			}
+			break;
+		}
+
+		default:
+			BOOST_ASSERT(false);
+	}
+
+	if (intrinsic == IN_BSWAP || intrinsic == IN_ROTL || intrinsic == IN_ROTR) {
+		if (tgt->data_type == DT_SINT) signExtend(m, r, size);
+		else zeroExtend(m, r, size);
+	}
+}
+
+// tgt = tgt + first * second (by fma_type)
+void PlnX86_64Generator::genFMA(PlnGenEntity* tgt, PlnGenEntity* first, PlnGenEntity* second, int fma_type, string comment)
+{
+	BOOST_ASSERT(cpu_features & CPUF_FMA);
+	BOOST_ASSERT(tgt->type == GA_REG && regid_of(tgt) >= XMM0);
+	for (auto e: {first, second}) {
+		BOOST_ASSERT(e->data_type == DT_FLOAT && e->size == tgt->size);
+		BOOST_ASSERT(e->type == GA_REG || e->type == GA_MEM);
+	}
+
+	static const PlnX86_64Mnemonic fma_mnes[3][2] = {
+		{ VFMADD231SS, VFMADD231SD }, { VFNMADD231SS, VFNMADD231SD }, { VFMSUB231SS, VFMSUB231SD }
+	};
+	BOOST_ASSERT(fma_type >= FMA_ADD && fma_type <= FMA_SUB);
+	PlnX86_64Mnemonic mne = fma_mnes[fma_type][tgt->size == 8];
+
+	// The multiplicand must be on xmm register.
+	PlnOperandInfo* first_ope;
+	if (first->type == GA_REG && regid_of(first) >= XMM0) {
+		first_ope = ope(first);
+	} else {
+		if (first->type == GA_REG)	// float value on general register.
+			m.push(MOVQ, reg(regid_of(first)), reg(XMM11));
+		else
+			m.push(tgt->size == 8 ? MOVSD : MOVSS, ope(first), reg(XMM11));
+		first_ope = reg(XMM11);
+	}
+
+	if (second->type == GA_REG && regid_of(second) < XMM0) {
+		// float value on general register.
+		m.push(MOVQ, reg(regid_of(second)), reg(XMM12));
+		m.push(mne, reg(XMM12), first_ope, ope(tgt), comment);
+
+	} else {
+		m.push(mne, ope(second), first_ope, ope(tgt), comment);
+	}
 }
 
 void PlnX86_64Generator::genNullClear(vector<unique_ptr<PlnGenEntity>> &refs)
 {
-	if (refs.size() == 1) {
-		m.push(MOVQ, imm(0), ope(refs[0].get()));
+	// Clear continuous local vars by vector stores.
+	vector<int> disps;
+	vector<PlnGenEntity*> others;
+	if (refs.size() >= 2) {
+		for (auto& r: refs) {
+			if (r->type == GA_MEM && r->size == 8) {
+				auto adrs_ope = static_cast<PlnAdrsModeOperand*>(r->ope);
+				if (adrs_ope->base_regid == RBP && adrs_ope->index_regid == -1) {
+					disps.push_back(adrs_ope->displacement);
+					continue;
+				}
+			}
+			others.push_back(r.get());
+		}
+		sort(disps.begin(), disps.end());
+	} else {
+		for (auto& r: refs)
+			others.push_back(r.get());
+	}
 
-	} else if (refs.size() >= 2) {
+	bool cleared_xmm = false;
+	int i = 0;
+	while (i < disps.size()) {
+		int n = 1;
+		while (i+n < disps.size() && disps[i+n] == disps[i] + n*8)
+			n++;
+
+		for (int j=i; j<i+n; ) {
+			if (i+n-j >= 2) {
+				if (!cleared_xmm) {
+					m.push(PXOR, reg(XMM15), reg(XMM15));
+					cleared_xmm = true;
+				}
+				m.push(MOVDQU, reg(XMM15, 16), adrs(RBP, disps[j]));
+				j += 2;
+			} else {
+				m.push(MOVQ, imm(0), adrs(RBP, disps[j]));
+				j++;
+			}
+		}
+		i += n;
+	}
+
+	if (others.size() == 1) {
+		m.push(MOVQ, imm(0), ope(others[0]));
+
+	} else if (others.size() >= 2) {
 		m.push(XORQ, reg(RAX), reg(RAX));
 		
-		for (auto& r: refs) {
-			m.push(MOVQ, reg(RAX), ope(r.get()));
+		for (auto r: others) {
+			m.push(MOVQ, reg(RAX), ope(r));
 		}
 	}
 }
@@ -1745,6 +2288,247 @@ void PlnX86_64Generator::genMemCopy(int cp_unit, string& comment)
 	m.push(mnemonic, NULL, NULL, comment);
 }
 
+// Copy %rsi -> %rdi by moves. %rcx and %xmm15 are used as work.
+void PlnX86_64Generator::genUnrolledMemCopy(uint64_t cp_size, string& comment)
+{
+	int offset = 0;
+	auto move = [&](PlnX86_64Mnemonic mne, int regid, int size) {
+		m.push(mne, adrs(RSI, offset), reg(regid, size), offset ? "" : comment);
+		m.push(mne, reg(regid, size), adrs(RDI, offset));
+		offset += size;
+		cp_size -= size;
+	};
+
+	if (cpu_features & CPUF_AVX) {
+		bool used_ymm = cp_size >= 32;
+		while (cp_size >= 32)
+			move(VMOVDQU, XMM15, 32);
+		if (cp_size >= 16)
+			move(VMOVDQU, XMM15, 16);
+		if (used_ymm)
+			m.push(VZEROUPPER);
+
+	} else {
+		while (cp_size >= 16)
+			move(MOVDQU, XMM15, 16);
+	}
+
+	static const PlnX86_64Mnemonic movs[] = { MOVB, MOVW, MOVL, MOVQ };
+	for (int i=3, unit=8; unit >= 1; i--, unit /= 2)
+		while (cp_size >= unit)
+			move(movs[i], RCX, unit);
+}
+
+// Set the pointers to the items that follow the pointer table.
+// %rdi: pointer table -> next of the table.
+void PlnX86_64Generator::genPtrTableInit(uint64_t ptr_num, uint64_t item_size, int jmp_id, string& comment)
+{
+	BOOST_ASSERT(ptr_num > 0);
+	m.push(LEA, adrs(RDI, ptr_num*8), reg(RSI), comment);
+	m.push(MOVQ, imm(ptr_num), reg(RCX));
+	m.push(LABEL, lbl(".L", jmp_id));
+	m.push(MOVQ, reg(RSI), adrs(RDI));
+	m.push(ADDQ, imm(8), reg(RDI));
+	m.push(ADDQ, imm(item_size), reg(RSI));
+	m.push(DECQ, reg(RCX));
+	m.push(JNE, lbl(".L", jmp_id));
+}
+
+static PlnX86_64Mnemonic getVecMne(int vop, int data_type, int item_size, bool use_avx)
+{
+	BOOST_ASSERT(item_size == 4 || item_size == 8);
+	int t = data_type == DT_FLOAT ? (item_size == 4 ? 0 : 1) : (item_size == 4 ? 2 : 3);
+	static const PlnX86_64Mnemonic sse_tbl[][4] = {
+		{ MOVUPS, MOVUPD, MOVDQU, MOVDQU },
+		{ ADDPS, ADDPD, PADDD, PADDQ },
+		{ SUBPS, SUBPD, PSUBD, PSUBQ },
+		{ MULPS, MULPD, MNE_NONE, MNE_NONE },
+		{ DIVPS, DIVPD, MNE_NONE, MNE_NONE },
+	};
+	static const PlnX86_64Mnemonic avx_tbl[][4] = {
+		{ VMOVUPS, VMOVUPD, VMOVDQU, VMOVDQU },
+		{ VADDPS, VADDPD, VPADDD, VPADDQ },
+		{ VSUBPS, VSUBPD, VPSUBD, VPSUBQ },
+		{ VMULPS, VMULPD, MNE_NONE, MNE_NONE },
+		{ VDIVPS, VDIVPD, MNE_NONE, MNE_NONE },
+	};
+
+	int i;
+	switch (vop) {
+		case VOP_LOAD: case VOP_STORE: i = 0; break;
+		case VOP_ADD: case VOP_SUM: i = 1; break;
+		case VOP_SUB: i = 2; break;
+		case VOP_MUL: i = 3; break;
+		case VOP_DIV: i = 4; break;
+		default:
+			BOOST_ASSERT(false);
+	}
+
+	PlnX86_64Mnemonic mne = use_avx ? avx_tbl[i][t] : sse_tbl[i][t];
+	BOOST_ASSERT(mne != MNE_NONE);
+	return mne;
+}
+
+void PlnX86_64Generator::genVectorLoop(vector<PlnVecCode>& codes, int data_type, int item_size,
+		vector<unique_ptr<PlnGenEntity>>& args, vector<unique_ptr<PlnGenEntity>>& rets, int loop_id, int end_id)
+{
+	BOOST_ASSERT(codes.size() && args.size() >= 2);
+	// Reduction keeps 128 bit to fold the total with SSE2 instructions.
+	bool is_sum = codes.back().ope == VOP_SUM;
+	bool use_avx = (cpu_features & CPUF_AVX2) && !is_sum;
+	int vsize = use_avx ? 32 : 16;
+	int pack_num = vsize / item_size;
+	int index = regid_of(args[0].get());
+	int limit = regid_of(args[1].get());
+	PlnX86_64Mnemonic mov = getVecMne(VOP_LOAD, data_type, item_size, use_avx);
+	PlnX86_64Mnemonic copy = use_avx ? VMOVAPS : MOVAPS;
+
+	// Broadcast loop invariant values to all elements.
+	vector<int> vregs(args.size(), -1);
+	int next_scalar = XMM0;
+	for (auto& c: codes) {
+		if (c.ope != VOP_SCALAR || vregs[c.id] >= 0)
+			continue;
+
+		int arg = regid_of(args[c.id].get());
+		int vreg;
+		if (data_type == DT_FLOAT) {
+			BOOST_ASSERT(arg >= XMM0);
+			vreg = arg;
+		} else {
+			BOOST_ASSERT(is_greg(arg));
+			while (next_scalar <= XMM7 && std::find(vregs.begin(), vregs.end(), next_scalar) != vregs.end())
+				next_scalar++;
+			BOOST_ASSERT(next_scalar <= XMM7);
+			vreg = next_scalar;
+			if (item_size == 4) m.push(MOVD, reg(arg, 4), reg(vreg, 8));
+			else m.push(MOVQ, reg(arg), reg(vreg, 8));
+		}
+
+		if (use_avx) {
+			PlnX86_64Mnemonic bc = data_type == DT_FLOAT ? (item_size == 4 ? VBROADCASTSS : VBROADCASTSD)
+				: (item_size == 4 ? VPBROADCASTD : VPBROADCASTQ);
+			m.push(bc, reg(vreg, 16), reg(vreg, 32));
+
+		} else if (data_type == DT_FLOAT) {
+			if (item_size == 4) {
+				m.push(UNPCKLPS, reg(vreg, 16), reg(vreg, 16));
+				m.push(MOVLHPS, reg(vreg, 16), reg(vreg, 16));
+			} else {
+				m.push(UNPCKLPD, reg(vreg, 16), reg(vreg, 16));
+			}
+
+		} else {
+			if (item_size == 4)
+				m.push(PUNPCKLDQ, reg(vreg, 16), reg(vreg, 16));
+			m.push(PUNPCKLQDQ, reg(vreg, 16), reg(vreg, 16));
+		}
+		vregs[c.id] = vreg;
+	}
+
+	m.push(LEA, adrs(limit, -pack_num), reg(R11), "vectorized loop");
+	if (is_sum)
+		m.push(PXOR, reg(XMM15, 16), reg(XMM15, 16));
+	m.push(CMPQ, reg(R11), reg(index));
+	m.push(JG, lbl(".L", end_id));
+	m.push(LABEL, lbl(".L", loop_id));
+
+	// Calculate by stack machine. XMM8-14 are for work.
+	vector<int> stack;
+	auto nextWork = [&stack]() {
+		int next = XMM8;
+		for (int r: stack)
+			if (r >= next) next = r + 1;
+		BOOST_ASSERT(next <= XMM14);
+		return next;
+	};
+
+	for (auto& c: codes) {
+		switch (c.ope) {
+			case VOP_LOAD: {
+				int w = nextWork();
+				m.push(mov, adrs(regid_of(args[c.id].get()), 0, index, item_size), reg(w, vsize));
+				stack.push_back(w);
+				break;
+			}
+			case VOP_SCALAR:
+				stack.push_back(vregs[c.id]);
+				break;
+
+			case VOP_ADD: case VOP_SUB: case VOP_MUL: case VOP_DIV: {
+				BOOST_ASSERT(stack.size() >= 2);
+				int r = stack.back(); stack.pop_back();
+				int l = stack.back(); stack.pop_back();
+				PlnX86_64Mnemonic mne = getVecMne(c.ope, data_type, item_size, use_avx);
+				if (l < XMM8) {	// Don't break the broadcasted value.
+					if (r >= XMM8 && (c.ope == VOP_ADD || c.ope == VOP_MUL)) {
+						m.push(mne, reg(l, vsize), reg(r, vsize));
+						stack.push_back(r);
+						break;
+					}
+					int w = nextWork();
+					if (w == r) w++;
+					BOOST_ASSERT(w <= XMM14);
+					m.push(copy, reg(l, vsize), reg(w, vsize));
+					l = w;
+				}
+				m.push(mne, reg(r, vsize), reg(l, vsize));
+				stack.push_back(l);
+				break;
+			}
+			case VOP_STORE:
+				BOOST_ASSERT(stack.size() == 1);
+				m.push(mov, reg(stack.back(), vsize), adrs(regid_of(args[c.id].get()), 0, index, item_size));
+				break;
+
+			case VOP_SUM:
+				BOOST_ASSERT(stack.size() == 1);
+				m.push(getVecMne(VOP_SUM, data_type, item_size, false), reg(stack.back(), 16), reg(XMM15, 16));
+				break;
+
+			default:
+				BOOST_ASSERT(false);
+		}
+	}
+
+	m.push(ADDQ, imm(pack_num), reg(index));
+	m.push(CMPQ, reg(R11), reg(index));
+	m.push(JLE, lbl(".L", loop_id));
+	m.push(LABEL, lbl(".L", end_id));
+
+	if (use_avx)
+		m.push(VZEROUPPER, NULL, NULL);
+
+	if (is_sum) {
+		BOOST_ASSERT(data_type != DT_FLOAT && rets.size() == 2);
+		int sum = regid_of(args.back().get());
+		PlnX86_64Mnemonic add = getVecMne(VOP_SUM, data_type, item_size, false);
+		m.push(MOVDQA, reg(XMM15, 16), reg(XMM14, 16));
+		m.push(PSRLDQ, imm(8), reg(XMM14, 16));
+		m.push(add, reg(XMM14, 16), reg(XMM15, 16));
+		if (item_size == 4) {
+			m.push(MOVDQA, reg(XMM15, 16), reg(XMM14, 16));
+			m.push(PSRLDQ, imm(4), reg(XMM14, 16));
+			m.push(add, reg(XMM14, 16), reg(XMM15, 16));
+			m.push(MOVD, reg(XMM15, 8), reg(R11, 4));
+		} else {
+			m.push(MOVQ, reg(XMM15, 8), reg(R11));
+		}
+		m.push(ADDQ, reg(R11), reg(sum));
+
+		BOOST_ASSERT(regid_of(rets[0].get()) != sum);
+		if (regid_of(rets[0].get()) != index)
+			m.push(MOVQ, reg(index), reg(regid_of(rets[0].get())));
+		if (regid_of(rets[1].get()) != sum)
+			m.push(MOVQ, reg(sum), reg(regid_of(rets[1].get())));
+
+	} else {
+		BOOST_ASSERT(rets.size() == 1);
+		if (regid_of(rets[0].get()) != index)
+			m.push(MOVQ, reg(index), reg(regid_of(rets[0].get())));
+	}
+}
+
 unique_ptr<PlnGenEntity> PlnX86_64Generator::getEntity(PlnDataPlace* dp)
 {
 	BOOST_ASSERT(dp->data_type != DT_UNKNOWN);
@@ -6,6 +6,19 @@
 #include "../PlnGenerator.h"
 #include "PlnX86_64RegisterMachine.h"
 
+// Target CPU features that affect instruction selection.
+enum {
+	CPUF_SSE2 = 1,	// Baseline of x86-64.
+	CPUF_AVX = 1 << 1,	// VEX encoding of float operations.
+	CPUF_AVX2 = 1 << 2,
+	CPUF_SSE41 = 1 << 3,
+	CPUF_POPCNT = 1 << 4,
+	CPUF_LZCNT = 1 << 5,
+	CPUF_BMI1 = 1 << 6,	// tzcnt
+	CPUF_BMI2 = 1 << 7,	// shlx, sarx, shrx, rorx
+	CPUF_FMA = 1 << 8,
+};
+
 class PlnX86_64Generator : public PlnGenerator
 {
 	PlnX86_64RegisterMachine m;
@@ -36,8 +49,12 @@ class PlnX86_64Generator : public PlnGenerator
 	int registerConstData(vector<PlnRoData> &rodata);
 
 public:
+	int cpu_features;
+	bool omit_frame_pointer;	// Address stack frame by RSP.
+
 	PlnX86_64Generator(ostream& ostrm);
 	~PlnX86_64Generator();
+	static int getCPUFeatures(const string& arch);	// -1: unknown arch
 	void comment(const string& s) override;
 
 	void genSecReadOnlyData() override;
@@ -51,6 +68,8 @@ public:
 	void genEntryFunc() override;
 	void genLocalVarArea(int size) override;
 	void genEndFunc() override;
+	bool getDestroyRegs(const string& func_name, vector<int>& regids) override;
+	void genPoolAllocator(bool with_stats) override;
 
 	void genCCall(string& cfuncname, vector<int> &arg_dtypes, bool has_va_arg) override;
 	void genSysCall(int id, const string& comment) override;
@@ -67,9 +86,18 @@ public:
 	void genMod(PlnGenEntity* tgt, PlnGenEntity* second, string comment) override;
 	int genCmp(PlnGenEntity* first, PlnGenEntity* second, int cmp_type, string comment) override;
 	int genMoveCmpFlag(PlnGenEntity* tgt, int cmp_type, string comment) override;
+	void genCondMove(PlnGenEntity* tgt, PlnGenEntity* src, int cmp_type, string comment) override;
+	void genMinMax(PlnGenEntity* tgt, PlnGenEntity* second, bool is_min, string comment) override;
+	void genIntrinsic(int intrinsic, PlnGenEntity* tgt, PlnGenEntity* second, string comment) override;
+	void genBitIntrinsic(int intrinsic, int size, PlnGenEntity* tgt, PlnGenEntity* second, string comment) override;
+	void genFMA(PlnGenEntity* tgt, PlnGenEntity* first, PlnGenEntity* second, int fma_type, string comment) override;
 
 	void genNullClear(vector<unique_ptr<PlnGenEntity>> &refs) override;
 	void genMemCopy(int cp_unit, string& comment) override;
+	void genUnrolledMemCopy(uint64_t cp_size, string& comment) override;
+	void genPtrTableInit(uint64_t ptr_num, uint64_t item_size, int jmp_id, string& comment) override;
+	void genVectorLoop(vector<PlnVecCode>& codes, int data_type, int item_size,
+			vector<unique_ptr<PlnGenEntity>>& args, vector<unique_ptr<PlnGenEntity>>& rets, int loop_id, int end_id) override;
 
 	unique_ptr<PlnGenEntity> getEntity(PlnDataPlace* dp) override;
 };
@@ -88,7 +116,7 @@ inline int regid_of(const PlnGenEntity *e) {
 }
 
 inline bool is_greg(int regid) {
-	return regid <= R15;
+	return regid < XMM0;
 }
 
 // Immediate operand (e.g. $10)
@@ -17,6 +17,8 @@
 #include "PlnX86_64Generator.h"
 #include "PlnX86_64RegisterMachineImp.h"
 #include "PlnX86_64RegisterSave.h"
+#include "PlnX86_64ControlFlowGraph.h"
+
 
 static const char* r(int rt, int size)
 {
@@ -74,52 +76,55 @@ static const char* r(int rt, int size)
 		tbl[R15][0] = "%r15b"; tbl[R15][1] = "%r15w";
 		tbl[R15][2] = "%r15d"; tbl[R15][3] = "%r15";
 
-		tbl[XMM0][0] = "%xmm0"; tbl[XMM0][1] = "%xmm0";
+		tbl[RBPG][0] = "%bpl"; tbl[RBPG][1] = "%bp";
+		tbl[RBPG][2] = "%ebp"; tbl[RBPG][3] = "%rbp";
+
+		tbl[XMM0][0] = "%xmm0"; tbl[XMM0][1] = "%ymm0";
 		tbl[XMM0][2] = "%xmm0"; tbl[XMM0][3] = "%xmm0";
 
-		tbl[XMM1][0] = "%xmm1"; tbl[XMM1][1] = "%xmm1";
+		tbl[XMM1][0] = "%xmm1"; tbl[XMM1][1] = "%ymm1";
 		tbl[XMM1][2] = "%xmm1"; tbl[XMM1][3] = "%xmm1";
 
-		tbl[XMM2][0] = "%xmm2"; tbl[XMM2][1] = "%xmm2";
+		tbl[XMM2][0] = "%xmm2"; tbl[XMM2][1] = "%ymm2";
 		tbl[XMM2][2] = "%xmm2"; tbl[XMM2][3] = "%xmm2";
 
-		tbl[XMM3][0] = "%xmm3"; tbl[XMM3][1] = "%xmm3";
+		tbl[XMM3][0] = "%xmm3"; tbl[XMM3][1] = "%ymm3";
 		tbl[XMM3][2] = "%xmm3"; tbl[XMM3][3] = "%xmm3";
 
-		tbl[XMM4][0] = "%xmm4"; tbl[XMM4][1] = "%xmm4";
+		tbl[XMM4][0] = "%xmm4"; tbl[XMM4][1] = "%ymm4";
 		tbl[XMM4][2] = "%xmm4"; tbl[XMM4][3] = "%xmm4";
 
-		tbl[XMM5][0] = "%xmm5"; tbl[XMM5][1] = "%xmm5";
+		tbl[XMM5][0] = "%xmm5"; tbl[XMM5][1] = "%ymm5";
 		tbl[XMM5][2] = "%xmm5"; tbl[XMM5][3] = "%xmm5";
 
-		tbl[XMM6][0] = "%xmm6"; tbl[XMM6][1] = "%xmm6";
+		tbl[XMM6][0] = "%xmm6"; tbl[XMM6][1] = "%ymm6";
 		tbl[XMM6][2] = "%xmm6"; tbl[XMM6][3] = "%xmm6";
 
-		tbl[XMM7][0] = "%xmm7"; tbl[XMM7][1] = "%xmm7";
+		tbl[XMM7][0] = "%xmm7"; tbl[XMM7][1] = "%ymm7";
 		tbl[XMM7][2] = "%xmm7"; tbl[XMM7][3] = "%xmm7";
 
-		tbl[XMM8][0] = "%xmm8"; tbl[XMM8][1] = "%xmm8";
+		tbl[XMM8][0] = "%xmm8"; tbl[XMM8][1] = "%ymm8";
 		tbl[XMM8][2] = "%xmm8"; tbl[XMM8][3] = "%xmm8";
 
-		tbl[XMM9][0] = "%xmm9"; tbl[XMM9][1] = "%xmm9";
+		tbl[XMM9][0] = "%xmm9"; tbl[XMM9][1] = "%ymm9";
 		tbl[XMM9][2] = "%xmm9"; tbl[XMM9][3] = "%xmm9";
 
-		tbl[XMM10][0] = "%xmm10"; tbl[XMM10][1] = "%xmm10";
+		tbl[XMM10][0] = "%xmm10"; tbl[XMM10][1] = "%ymm10";
 		tbl[XMM10][2] = "%xmm10"; tbl[XMM10][3] = "%xmm10";
 
-		tbl[XMM11][0] = "%xmm11"; tbl[XMM11][1] = "%xmm11";
+		tbl[XMM11][0] = "%xmm11"; tbl[XMM11][1] = "%ymm11";
 		tbl[XMM11][2] = "%xmm11"; tbl[XMM11][3] = "%xmm11";
 
-		tbl[XMM12][0] = "%xmm12"; tbl[XMM12][1] = "%xmm12";
+		tbl[XMM12][0] = "%xmm12"; tbl[XMM12][1] = "%ymm12";
 		tbl[XMM12][2] = "%xmm12"; tbl[XMM12][3] = "%xmm12";
 
-		tbl[XMM13][0] = "%xmm13"; tbl[XMM13][1] = "%xmm13";
+		tbl[XMM13][0] = "%xmm13"; tbl[XMM13][1] = "%ymm13";
 		tbl[XMM13][2] = "%xmm13"; tbl[XMM13][3] = "%xmm13";
 
-		tbl[XMM14][0] = "%xmm14"; tbl[XMM14][1] = "%xmm14";
+		tbl[XMM14][0] = "%xmm14"; tbl[XMM14][1] = "%ymm14";
 		tbl[XMM14][2] = "%xmm14"; tbl[XMM14][3] = "%xmm14";
 
-		tbl[XMM15][0] = "%xmm15"; tbl[XMM15][1] = "%xmm15";
+		tbl[XMM15][0] = "%xmm15"; tbl[XMM15][1] = "%ymm15";
 		tbl[XMM15][2] = "%xmm15"; tbl[XMM15][3] = "%xmm15";
 
 		tbl[RIP][0] = "%rip"; tbl[RIP][1] = "%rip";
@@ -134,8 +139,10 @@ static const char* r(int rt, int size)
 	} else {
 		int i;
 		switch (size) {
-			case 4: case 8:
+			case 4: case 8: case 16:
 				i = 0; break;
+			case 32:
+				i = 1; break;
 			default:
 				BOOST_ASSERT(false);
 		}
@@ -239,6 +246,7 @@ static void initMnes()
 	mnes[MULSD] = "mulsd";
 	mnes[MULSS] = "mulss";
 	mnes[IMULQ] = "imulq";
+	mnes[MULQ] = "mulq";
 	mnes[DIVSD] = "divsd";
 	mnes[DIVSS] = "divss";
 	mnes[DIVQ] = "divq";
@@ -246,6 +254,11 @@ static void initMnes()
 	mnes[IDIVQ] = "idivq";
 	mnes[CLTQ] = "cltq";
 
+	mnes[MAXSS] = "maxss";
+	mnes[MAXSD] = "maxsd";
+	mnes[MINSS] = "minss";
+	mnes[MINSD] = "minsd";
+
 	mnes[XORQ] = "xorq";
 	mnes[XORPD] = "xorpd";
 	mnes[XORPS] = "xorps";
@@ -277,6 +290,151 @@ static void initMnes()
 	mnes[SETBE] = "setbe";
 	mnes[SETAE] = "setae";
 
+	mnes[CMOVE] = "cmove";
+	mnes[CMOVNE] = "cmovne";
+	mnes[CMOVL] = "cmovl";
+	mnes[CMOVG] = "cmovg";
+	mnes[CMOVLE] = "cmovle";
+	mnes[CMOVGE] = "cmovge";
+	mnes[CMOVB] = "cmovb";
+	mnes[CMOVA] = "cmova";
+	mnes[CMOVBE] = "cmovbe";
+	mnes[CMOVAE] = "cmovae";
+
+	mnes[MOVDQU] = "movdqu";
+	mnes[PXOR] = "pxor";
+	mnes[VMOVDQU] = "vmovdqu";
+	mnes[VZEROUPPER] = "vzeroupper";
+
+	mnes[MOVD] = "movd";
+	mnes[MOVDQA] = "movdqa";
+	mnes[MOVAPS] = "movaps";
+	mnes[MOVUPS] = "movups";
+	mnes[MOVUPD] = "movupd";
+	mnes[MOVLHPS] = "movlhps";
+	mnes[ADDPS] = "addps";
+	mnes[ADDPD] = "addpd";
+	mnes[SUBPS] = "subps";
+	mnes[SUBPD] = "subpd";
+	mnes[MULPS] = "mulps";
+	mnes[MULPD] = "mulpd";
+	mnes[DIVPS] = "divps";
+	mnes[DIVPD] = "divpd";
+	mnes[PADDD] = "paddd";
+	mnes[PADDQ] = "paddq";
+	mnes[PSUBD] = "psubd";
+	mnes[PSUBQ] = "psubq";
+	mnes[PSRLDQ] = "psrldq";
+	mnes[PUNPCKLDQ] = "punpckldq";
+	mnes[PUNPCKLQDQ] = "punpcklqdq";
+	mnes[UNPCKLPS] = "unpcklps";
+	mnes[UNPCKLPD] = "unpcklpd";
+
+	mnes[VADDSS] = "vaddss";
+	mnes[VADDSD] = "vaddsd";
+	mnes[VSUBSS] = "vsubss";
+	mnes[VSUBSD] = "vsubsd";
+	mnes[VMULSS] = "vmulss";
+	mnes[VMULSD] = "vmulsd";
+	mnes[VDIVSS] = "vdivss";
+	mnes[VDIVSD] = "vdivsd";
+	mnes[VMAXSS] = "vmaxss";
+	mnes[VMAXSD] = "vmaxsd";
+	mnes[VMINSS] = "vminss";
+	mnes[VMINSD] = "vminsd";
+	mnes[VMOVSS] = "vmovss";
+	mnes[VMOVSD] = "vmovsd";
+	mnes[VXORPS] = "vxorps";
+	mnes[VXORPD] = "vxorpd";
+	mnes[VCVTSD2SS] = "vcvtsd2ss";
+	mnes[VCVTSS2SD] = "vcvtss2sd";
+	mnes[VCVTTSD2SI] = "vcvttsd2si";
+	mnes[VCVTTSS2SI] = "vcvttss2si";
+	mnes[VCVTSI2SS] = "vcvtsi2ss";
+	mnes[VCVTSI2SD] = "vcvtsi2sd";
+	mnes[VUCOMISS] = "vucomiss";
+	mnes[VUCOMISD] = "vucomisd";
+	mnes[VANDPS] = "vandps";
+	mnes[VANDPD] = "vandpd";
+	mnes[VANDNPS] = "vandnps";
+	mnes[VANDNPD] = "vandnpd";
+	mnes[VORPS] = "vorps";
+	mnes[VORPD] = "vorpd";
+	mnes[VCMPUNORDSS] = "vcmpunordss";
+	mnes[VCMPUNORDSD] = "vcmpunordsd";
+	mnes[VSQRTSS] = "vsqrtss";
+	mnes[VSQRTSD] = "vsqrtsd";
+	mnes[VROUNDSS] = "vroundss";
+	mnes[VROUNDSD] = "vroundsd";
+	mnes[VMOVD] = "vmovd";
+	mnes[VMOVQ] = "vmovq";
+	mnes[VMOVDQA] = "vmovdqa";
+	mnes[VMOVLHPS] = "vmovlhps";
+	mnes[VUNPCKLPS] = "vunpcklps";
+	mnes[VUNPCKLPD] = "vunpcklpd";
+	mnes[VPSRLDQ] = "vpsrldq";
+	mnes[VPUNPCKLDQ] = "vpunpckldq";
+	mnes[VPUNPCKLQDQ] = "vpunpcklqdq";
+	mnes[VPXOR] = "vpxor";
+
+	mnes[VADDPS] = "vaddps";
+	mnes[VADDPD] = "vaddpd";
+	mnes[VSUBPS] = "vsubps";
+	mnes[VSUBPD] = "vsubpd";
+	mnes[VMULPS] = "vmulps";
+	mnes[VMULPD] = "vmulpd";
+	mnes[VDIVPS] = "vdivps";
+	mnes[VDIVPD] = "vdivpd";
+	mnes[VPADDD] = "vpaddd";
+	mnes[VPADDQ] = "vpaddq";
+	mnes[VPSUBD] = "vpsubd";
+	mnes[VPSUBQ] = "vpsubq";
+	mnes[VBROADCASTSS] = "vbroadcastss";
+	mnes[VBROADCASTSD] = "vbroadcastsd";
+	mnes[VPBROADCASTD] = "vpbroadcastd";
+	mnes[VPBROADCASTQ] = "vpbroadcastq";
+	mnes[VMOVAPS] = "vmovaps";
+	mnes[VMOVUPS] = "vmovups";
+	mnes[VMOVUPD] = "vmovupd";
+	mnes[VFMADD231SS] = "vfmadd231ss";
+	mnes[VFMADD231SD] = "vfmadd231sd";
+	mnes[VFNMADD231SS] = "vfnmadd231ss";
+	mnes[VFNMADD231SD] = "vfnmadd231sd";
+	mnes[VFMSUB231SS] = "vfmsub231ss";
+	mnes[VFMSUB231SD] = "vfmsub231sd";
+
+	mnes[ANDPS] = "andps";
+	mnes[ANDPD] = "andpd";
+	mnes[ANDNPS] = "andnps";
+	mnes[ANDNPD] = "andnpd";
+	mnes[ORPS] = "orps";
+	mnes[ORPD] = "orpd";
+	mnes[CMPUNORDSS] = "cmpunordss";
+	mnes[CMPUNORDSD] = "cmpunordsd";
+	mnes[SQRTSS] = "sqrtss";
+	mnes[SQRTSD] = "sqrtsd";
+	mnes[ROUNDSS] = "roundss";
+	mnes[ROUNDSD] = "roundsd";
+
+	mnes[BSFQ] = "bsfq";
+	mnes[BSRQ] = "bsrq";
+	mnes[BSWAPL] = "bswapl";
+	mnes[BSWAPQ] = "bswapq";
+	mnes[BTSQ] = "btsq";
+	mnes[LZCNTQ] = "lzcntq";
+	mnes[POPCNTQ] = "popcntq";
+	mnes[TZCNTQ] = "tzcntq";
+	mnes[ROLB] = "rolb";
+	mnes[ROLW] = "rolw";
+	mnes[ROLL] = "roll";
+	mnes[ROLQ] = "rolq";
+	mnes[RORB] = "rorb";
+	mnes[RORW] = "rorw";
+	mnes[RORL] = "rorl";
+	mnes[RORQ] = "rorq";
+	mnes[RORXL] = "rorxl";
+	mnes[RORXQ] = "rorxq";
+
 	mnes[REP_MOVSQ] = "rep movsq";
 	mnes[REP_MOVSL] = "rep movsl";
 	mnes[REP_MOVSW] = "rep movsw";
@@ -302,6 +460,13 @@ void PlnX86_64RegisterMachine::push(PlnX86_64Mnemonic mne, PlnOperandInfo *src,
 	BOOST_ASSERT(!((mne == PUSHQ || mne == POPQ) && regid_of(src) != RBP));
 }
 
+// VEX 3 operands form that doesn't destroy the second source.
+void PlnX86_64RegisterMachine::push(PlnX86_64Mnemonic mne, PlnOperandInfo *src, PlnOperandInfo* src2, PlnOperandInfo* dst, string comment)
+{
+	BOOST_ASSERT(src2 && src2->type == OP_REG && dst);
+	imp->opecodes.push_back({mne, src, src2, dst, comment});
+}
+
 void PlnX86_64RegisterMachine::reserve(int num)
 {
 	for (int i=0; i<num; i++)
@@ -318,6 +483,15 @@ void PlnX86_64RegisterMachine::memoRequestedStackSize(int size)
 	imp->requested_stack_size = size;
 }
 
+bool PlnX86_64RegisterMachine::getDestroyRegs(const string& func_name, vector<int>& regids)
+{
+	auto it = imp->func_destroy_regs.find(func_name);
+	if (it == imp->func_destroy_regs.end())
+		return false;
+	regids = it->second;
+	return true;
+}
+
 static ostream& operator<<(ostream& out, const PlnOpeCode& oc)
 {
 	char buf[256];
@@ -336,18 +510,59 @@ static ostream& operator<<(ostream& out, const PlnOpeCode& oc)
 
 	out << "	" << mnes[oc.mne];
 	if (oc.src) out << " " << oc.src->str(buf);
-	if (oc.dst) out << ", " << oc.dst->str(buf);
+	if (oc.src2) out << ", " << oc.src2->str(buf);
+	if (oc.dst) {
+		// VEX encoded calculation has 3 operands.
+		// Output the destructive form. e.g.) vaddps %ymm9, %ymm8, %ymm8
+		switch (oc.mne) {
+			case VADDSS: case VADDSD: case VSUBSS: case VSUBSD:
+			case VMULSS: case VMULSD: case VDIVSS: case VDIVSD:
+			case VMAXSS: case VMAXSD: case VMINSS: case VMINSD:
+			case VXORPS: case VXORPD: case VCVTSD2SS: case VCVTSS2SD:
+			case VCVTSI2SS: case VCVTSI2SD:
+			case VANDPS: case VANDPD: case VANDNPS: case VANDNPD:
+			case VORPS: case VORPD: case VCMPUNORDSS: case VCMPUNORDSD:
+			case VSQRTSS: case VSQRTSD:
+			case VADDPS: case VADDPD: case VSUBPS: case VSUBPD:
+			case VMULPS: case VMULPD: case VDIVPS: case VDIVPD:
+			case VPADDD: case VPADDQ: case VPSUBD: case VPSUBQ:
+			case VMOVLHPS: case VUNPCKLPS: case VUNPCKLPD:
+			case VPSRLDQ: case VPUNPCKLDQ: case VPUNPCKLQDQ: case VPXOR:
+				out << ", " << oc.dst->str(buf);
+				break;
+			case VROUNDSS: case VROUNDSD:	// e.g.) vroundsd $9, %xmm0, %xmm0, %xmm0
+				out << ", " << oc.dst->str(buf);
+				// fall through
+			case ROUNDSS: case ROUNDSD:	// e.g.) roundsd $9, %xmm0, %xmm0
+			case RORXL: case RORXQ:
+				out << ", " << oc.dst->str(buf);
+				break;
+			case VMOVSS: case VMOVSD:	// Only register to register has 3 operands.
+				if (oc.src->type == OP_REG && oc.dst->type == OP_REG)
+					out << ", " << oc.dst->str(buf);
+				break;
+			default:
+				break;
+		}
+		out << ", " << oc.dst->str(buf);
+	}
 	if (oc.comment != "") out << "	# " << oc.comment;
 
 	return out;
 }
 
 // Optimazations
+static int getFrameSize(vector<PlnOpeCode> &opecodes);
 static void removeStackArea(vector<PlnOpeCode> &opecodes);
+static void omitFramePointer(vector<PlnOpeCode> &opecodes);
+static void encodeVex(vector<PlnOpeCode> &opecodes);
 static void removeOmittableMoveToReg(vector<PlnOpeCode> &opecodes);
 static void asmOptimize(vector<PlnOpeCode> &opecodes);
+static void tailCallOptimize(vector<PlnOpeCode> &opecodes);
+static vector<bool> findLoopHeads(vector<PlnOpeCode> &opecodes);
+static vector<int> findDestroyRegs(vector<PlnOpeCode> &opecodes, std::map<string, vector<int>> &func_destroy_regs);
 
-void PlnX86_64RegisterMachine::popOpecodes(ostream& os)
+void PlnX86_64RegisterMachine::popOpecodes(ostream& os, bool use_vex, bool omit_fp)
 {
 	if (!mnes.size())
 		initMnes();
@@ -361,23 +576,47 @@ void PlnX86_64RegisterMachine::popOpecodes(ostream& os)
 
 	// Note: It may change RBP->RSP.
 	// 		 So this should be execute after removeOmittableMoveToReg().
-	if (!imp->has_call)
+	// Leaf function can use the red zone (128 bytes below RSP) without frame.
+	bool has_frame = true;
+	if (!imp->has_call && getFrameSize(imp->opecodes) <= 128) {
 		removeStackArea(imp->opecodes);
+		has_frame = false;
+	}
 
 	asmOptimize(imp->opecodes);
 
-	os << ".balign 16\n";
+	// Note: This should be executed after register save is added.
+	if (imp->has_call && imp->ret_num)
+		tailCallOptimize(imp->opecodes);
+
+	if (omit_fp && has_frame)
+		omitFramePointer(imp->opecodes);
+
+	if (use_vex)
+		encodeVex(imp->opecodes);
+
 	BOOST_ASSERT(imp->opecodes.front().mne == LABEL);
+	if (imp->ret_num) {	// Not top level
+		auto label_ope = static_cast<PlnLabelOperand*>(imp->opecodes.front().src);
+		imp->func_destroy_regs[label_ope->label] = findDestroyRegs(imp->opecodes, imp->func_destroy_regs);
+	}
+
+	os << ".balign 16\n";
+	vector<bool> loop_heads = findLoopHeads(imp->opecodes);
 	PlnX86_64Mnemonic pre_mne = MNE_SIZE;
-	for (PlnOpeCode& oc: imp->opecodes) {
-		if (oc.mne == LABEL) {
-			if (pre_mne == RET || pre_mne == JMP) {
+	for (int i=0; i<imp->opecodes.size(); i++) {
+		PlnOpeCode& oc = imp->opecodes[i];
+		if (oc.mne == LABEL && i > 0) {
+			if (loop_heads[i]) {
+				os << ".balign 16\n";
+			} else if (pre_mne == RET || pre_mne == JMP) {
 				os << ".balign 2\n";
 			}
 		}
 		if (oc.mne != MNE_NONE)
 			os << oc << "\n";
 		delete oc.src;
+		delete oc.src2;
 		delete oc.dst;
 		if (!(oc.mne == MNE_NONE || oc.mne == COMMENT))
 			pre_mne = oc.mne;
@@ -430,6 +669,158 @@ void removeStackArea(vector<PlnOpeCode> &opecodes)
 	}
 }
 
+int getFrameSize(vector<PlnOpeCode> &opecodes)
+{
+	for (auto &opec: opecodes)
+		if (opec.mne == SUBQ && opec.dst->type == OP_REG && regid_of(opec.dst) == RSP)
+			return int64_of(opec.src);
+	return 0;
+}
+
+// Address the stack frame by RSP instead of RBP.
+// RSP is not changed between prologue and epilogue because PUSH/POP is not used.
+// e.g.) pushq %rbp; movq %rsp, %rbp; subq $16, %rsp => subq $24, %rsp
+//       -8(%rbp) => 8(%rsp), 16(%rbp) => 32(%rsp)
+void omitFramePointer(vector<PlnOpeCode> &opecodes)
+{
+	int frame_size = 8;	// Keep the alignment of pushed RBP.
+	int push_i = -1;
+	for (int i=0; i<opecodes.size(); i++) {
+		PlnOpeCode &opec = opecodes[i];
+		if (opec.mne == PUSHQ) {
+			BOOST_ASSERT(regid_of(opec.src) == RBP);
+			push_i = i;
+		} else if (opec.mne == SUBQ && opec.dst->type == OP_REG && regid_of(opec.dst) == RSP) {
+			frame_size += int64_of(opec.src);
+			opec.mne = MNE_NONE;
+			break;
+		}
+	}
+	BOOST_ASSERT(push_i >= 0);
+
+	for (int i=0; i<opecodes.size(); i++) {
+		PlnOpeCode &opec = opecodes[i];
+		switch (opec.mne) {
+			case PUSHQ:	// pushq %rbp => subq $n, %rsp
+				delete opec.src;
+				opec = {SUBQ, new PlnImmOperand(frame_size), new PlnRegOperand(RSP, 8), ""};
+				continue;
+			case POPQ:	// popq %rbp => addq $n, %rsp
+				delete opec.src;
+				opec = {ADDQ, new PlnImmOperand(frame_size), new PlnRegOperand(RSP, 8), ""};
+				continue;
+			case MOVQ:	// movq %rsp, %rbp / movq %rbp, %rsp
+				if (opec.src->type == OP_REG && opec.dst->type == OP_REG
+						&& (regid_of(opec.src) == RBP || regid_of(opec.dst) == RBP)) {
+					opec.mne = MNE_NONE;
+					continue;
+				}
+				break;
+			case ADDQ:	// addq $n, %rsp of epilogue is merged to popq.
+				if (opec.src->type == OP_IMM && opec.dst->type == OP_REG && regid_of(opec.dst) == RSP) {
+					opec.mne = MNE_NONE;
+					continue;
+				}
+				break;
+			default:
+				break;
+		}
+
+		for (auto ope: {opec.src, opec.dst}) {
+			if (ope && ope->type == OP_ADRS) {
+				auto addr_ope = static_cast<PlnAdrsModeOperand*>(ope);
+				if (addr_ope->base_regid == RBP) {
+					addr_ope->base_regid = RSP;
+					addr_ope->displacement += frame_size - 8;
+				}
+				BOOST_ASSERT(addr_ope->index_regid != RBP);
+			}
+		}
+	}
+}
+
+static bool hasXmmOperand(const PlnOpeCode &opec)
+{
+	return (opec.src && opec.src->type == OP_REG && regid_of(opec.src) >= XMM0)
+		|| (opec.dst && opec.dst->type == OP_REG && regid_of(opec.dst) >= XMM0);
+}
+
+// Use VEX encoded instruction for all SSE operations
+// to avoid mixing legacy SSE and AVX.
+void encodeVex(vector<PlnOpeCode> &opecodes)
+{
+	for (auto &opec: opecodes) {
+		switch (opec.mne) {
+			case MOVQ:
+				if (hasXmmOperand(opec)) opec.mne = VMOVQ;
+				break;
+			case MOVD: opec.mne = VMOVD; break;
+			case ADDSS: opec.mne = VADDSS; break;
+			case ADDSD: opec.mne = VADDSD; break;
+			case SUBSS: opec.mne = VSUBSS; break;
+			case SUBSD: opec.mne = VSUBSD; break;
+			case MULSS: opec.mne = VMULSS; break;
+			case MULSD: opec.mne = VMULSD; break;
+			case DIVSS: opec.mne = VDIVSS; break;
+			case DIVSD: opec.mne = VDIVSD; break;
+			case MAXSS: opec.mne = VMAXSS; break;
+			case MAXSD: opec.mne = VMAXSD; break;
+			case MINSS: opec.mne = VMINSS; break;
+			case MINSD: opec.mne = VMINSD; break;
+			case MOVSS: opec.mne = VMOVSS; break;
+			case MOVSD: opec.mne = VMOVSD; break;
+			case XORPS: opec.mne = VXORPS; break;
+			case XORPD: opec.mne = VXORPD; break;
+			case CVTSD2SS: opec.mne = VCVTSD2SS; break;
+			case CVTSS2SD: opec.mne = VCVTSS2SD; break;
+			case CVTTSD2SI: opec.mne = VCVTTSD2SI; break;
+			case CVTTSS2SI: opec.mne = VCVTTSS2SI; break;
+			case CVTSI2SS: opec.mne = VCVTSI2SS; break;
+			case CVTSI2SD: opec.mne = VCVTSI2SD; break;
+			case UCOMISS: opec.mne = VUCOMISS; break;
+			case UCOMISD: opec.mne = VUCOMISD; break;
+			case ANDPS: opec.mne = VANDPS; break;
+			case ANDPD: opec.mne = VANDPD; break;
+			case ANDNPS: opec.mne = VANDNPS; break;
+			case ANDNPD: opec.mne = VANDNPD; break;
+			case ORPS: opec.mne = VORPS; break;
+			case ORPD: opec.mne = VORPD; break;
+			case CMPUNORDSS: opec.mne = VCMPUNORDSS; break;
+			case CMPUNORDSD: opec.mne = VCMPUNORDSD; break;
+			case SQRTSS: opec.mne = VSQRTSS; break;
+			case SQRTSD: opec.mne = VSQRTSD; break;
+			case ROUNDSS: opec.mne = VROUNDSS; break;
+			case ROUNDSD: opec.mne = VROUNDSD; break;
+
+			case MOVDQA: opec.mne = VMOVDQA; break;
+			case MOVDQU: opec.mne = VMOVDQU; break;
+			case MOVAPS: opec.mne = VMOVAPS; break;
+			case MOVUPS: opec.mne = VMOVUPS; break;
+			case MOVUPD: opec.mne = VMOVUPD; break;
+			case MOVLHPS: opec.mne = VMOVLHPS; break;
+			case UNPCKLPS: opec.mne = VUNPCKLPS; break;
+			case UNPCKLPD: opec.mne = VUNPCKLPD; break;
+			case ADDPS: opec.mne = VADDPS; break;
+			case ADDPD: opec.mne = VADDPD; break;
+			case SUBPS: opec.mne = VSUBPS; break;
+			case SUBPD: opec.mne = VSUBPD; break;
+			case MULPS: opec.mne = VMULPS; break;
+			case MULPD: opec.mne = VMULPD; break;
+			case DIVPS: opec.mne = VDIVPS; break;
+			case DIVPD: opec.mne = VDIVPD; break;
+			case PADDD: opec.mne = VPADDD; break;
+			case PADDQ: opec.mne = VPADDQ; break;
+			case PSUBD: opec.mne = VPSUBD; break;
+			case PSUBQ: opec.mne = VPSUBQ; break;
+			case PSRLDQ: opec.mne = VPSRLDQ; break;
+			case PUNPCKLDQ: opec.mne = VPUNPCKLDQ; break;
+			case PUNPCKLQDQ: opec.mne = VPUNPCKLQDQ; break;
+			case PXOR: opec.mne = VPXOR; break;
+			default: break;
+		}
+	}
+}
+
 // Remove omiitalbe move.
 enum RegState {
 	RS_UNKONWN,
@@ -534,9 +925,13 @@ void removeOmittableMoveToReg(vector<PlnOpeCode> &opecodes)
 			} else if (opec.dst->type == OP_ADRS) {
 				auto dst = static_cast<PlnAdrsModeOperand*>(opec.dst);
 				if (dst->base_regid == RBP && dst->index_regid==-1) {
-					// local var update
+					// local var update. vector store can update some vars.
+					int size = 8;
+					if (opec.src->type == OP_REG && regid_of(opec.src) >= XMM0)
+						size = static_cast<PlnRegOperand*>(opec.src)->size;
 					for (auto& r: regs) {
-						if (r.state == RS_STACK_VAR && r.src.displacement == dst->displacement)
+						if (r.state == RS_STACK_VAR && r.src.displacement < dst->displacement + size
+								&& dst->displacement < r.src.displacement + 8)
 							r.state = RS_UNKONWN;
 					}
 				}
@@ -546,12 +941,13 @@ void removeOmittableMoveToReg(vector<PlnOpeCode> &opecodes)
 			if (opec.src->type == OP_REG) {
 				switch (opec.mne) {
 					case INCQ: case DECQ: case NEGQ:
+					case BSWAPL: case BSWAPQ:
 					case SETE: case SETNE:
 					case SETL: case SETG: case SETLE: case SETGE:
 					case SETB: case SETA: case SETBE: case SETAE:
 						regs[regid_of(opec.src)].state = RS_UNKONWN;
 						break;
-					case IMULQ: case DIVQ: case CQTO: case IDIVQ:
+					case IMULQ: case MULQ: case DIVQ: case CQTO: case IDIVQ:
 						regs[RAX].state = RS_UNKONWN;
 						regs[RDX].state = RS_UNKONWN;
 						break;
@@ -636,3 +1032,167 @@ void asmOptimize(vector<PlnOpeCode> &opecodes)
 	}
 }
 
+static bool isFrameReg(PlnOperandInfo* ope)
+{
+	if (!ope) return false;
+	if (ope->type == OP_REG)
+		return regid_of(ope) == RSP || regid_of(ope) == RBP;
+	if (ope->type == OP_ADRS)
+		return static_cast<PlnAdrsModeOperand*>(ope)->base_regid == RSP;
+	return false;
+}
+
+static int skipNone(vector<PlnOpeCode> &opecodes, int i)
+{
+	while (i < opecodes.size() && (opecodes[i].mne == MNE_NONE || opecodes[i].mne == COMMENT))
+		i++;
+	return i;
+}
+
+// Replace the call just before return with jump.
+// The callee returns to the caller of this function directly.
+// e.g.) call f; addq $16, %rsp; popq %rbp; ret => addq $16, %rsp; popq %rbp; jmp f
+void tailCallOptimize(vector<PlnOpeCode> &opecodes)
+{
+	// The arguments on the stack and the address of local area
+	// are invalid after releasing the stack frame.
+	for (auto &opec: opecodes) {
+		switch (opec.mne) {
+			case PUSHQ: case POPQ:
+				continue;
+			case MOVQ:	// movq %rsp, %rbp
+				if (opec.src->type == OP_REG && regid_of(opec.src) == RSP
+						&& opec.dst->type == OP_REG && regid_of(opec.dst) == RBP)
+					continue;
+				break;
+			case ADDQ: case SUBQ:	// addq $n, %rsp
+				if (opec.src->type == OP_IMM && opec.dst->type == OP_REG && regid_of(opec.dst) == RSP)
+					continue;
+				break;
+			default:
+				break;
+		}
+		if (isFrameReg(opec.src) || isFrameReg(opec.src2) || isFrameReg(opec.dst))
+			return;
+		if (opec.mne == LEA && opec.src->type == OP_ADRS
+				&& static_cast<PlnAdrsModeOperand*>(opec.src)->base_regid == RBP)
+			return;
+	}
+
+	for (int i=0; i<opecodes.size(); i++) {
+		PlnOpeCode &call = opecodes[i];
+		if (call.mne != CALL || call.src->type != OP_LBL)
+			continue;
+
+		int j = skipNone(opecodes, i+1);
+		if (j < opecodes.size() && opecodes[j].mne == ADDQ
+				&& opecodes[j].dst->type == OP_REG && regid_of(opecodes[j].dst) == RSP)
+			j = skipNone(opecodes, j+1);
+
+		// Restore callee saved registers.
+		while (j < opecodes.size() && opecodes[j].mne == MOVQ
+				&& opecodes[j].src->type == OP_ADRS && opecodes[j].dst->type == OP_REG) {
+			int regid = regid_of(opecodes[j].dst);
+			if (regid != RBX && (regid < R12 || regid > RBPG))	// R12-R15, RBPG
+				break;
+			j = skipNone(opecodes, j+1);
+		}
+
+		if (j < opecodes.size() && opecodes[j].mne == POPQ && regid_of(opecodes[j].src) == RBP)
+			j = skipNone(opecodes, j+1);
+
+		if (j < opecodes.size() && opecodes[j].mne == RET) {
+			opecodes[j].mne = JMP;
+			opecodes[j].src = call.src;
+			opecodes[j].comment = "tail call";
+			call.mne = MNE_NONE;
+			call.src = NULL;
+		}
+	}
+}
+
+// Loop head: the label that is jumped from backward.
+vector<bool> findLoopHeads(vector<PlnOpeCode> &opecodes)
+{
+	vector<bool> loop_heads(opecodes.size(), false);
+	PlnX86_64ControlFlowGraph cfg(opecodes);
+
+	for (int i=0; i<cfg.blocks.size(); i++) {
+		PlnCFGBlock &b = cfg.blocks[i];
+		if (opecodes[b.first].mne != LABEL)
+			continue;
+		for (int pi: b.previous_blocks) {
+			if (pi >= i) {
+				loop_heads[b.first] = true;
+				break;
+			}
+		}
+	}
+
+	return loop_heads;
+}
+
+// Collect caller saved registers that are written in the function.
+// The callers can keep the values in other registers during the call.
+vector<int> findDestroyRegs(vector<PlnOpeCode> &opecodes, std::map<string, vector<int>> &func_destroy_regs)
+{
+	// Same as PlnX86_64DataAllocator.cpp
+	static const int DSTRY_TBL[] = { RAX, RDI, RSI, RDX, RCX, R8, R9, R10, R11 };
+	vector<bool> destroyed(REG_NUM, false);
+
+	for (auto &opec: opecodes) {
+		switch (opec.mne) {
+			case MNE_NONE: case COMMENT: case LABEL:
+				continue;
+			case JMP:	// Tail call.
+				if (static_cast<PlnLabelOperand*>(opec.src)->id != -1)
+					continue;
+			case CALL:
+			{
+				auto it = func_destroy_regs.end();
+				if (opec.src->type == OP_LBL)
+					it = func_destroy_regs.find(static_cast<PlnLabelOperand*>(opec.src)->label);
+				if (it != func_destroy_regs.end()) {
+					for (int id: it->second)
+						destroyed[id] = true;
+				} else {	// Unknown function: all of caller saved registers.
+					for (int id: DSTRY_TBL)
+						destroyed[id] = true;
+					for (int id = XMM0; id<=XMM15; id++)
+						destroyed[id] = true;
+				}
+				continue;
+			}
+			// Implicit operands.
+			case CQTO: case DIVQ: case IDIVQ: case MULQ:
+				destroyed[RAX] = destroyed[RDX] = true;
+				break;
+			case CLTQ:
+				destroyed[RAX] = true;
+				break;
+			case REP_MOVSQ: case REP_MOVSL: case REP_MOVSW: case REP_MOVSB:
+				destroyed[RCX] = destroyed[RDI] = destroyed[RSI] = true;
+				break;
+			case SYSCALL:
+				destroyed[RAX] = destroyed[RCX] = destroyed[R11] = true;
+				break;
+			default:
+				break;
+		}
+
+		// The destination is written. Single operand is also the destination. e.g.) incq %rax
+		PlnOperandInfo* dst = opec.dst ? opec.dst : opec.src;
+		if (dst && dst->type == OP_REG)
+			destroyed[regid_of(dst)] = true;
+	}
+
+	vector<int> regids;
+	for (int id: DSTRY_TBL)
+		if (destroyed[id])
+			regids.push_back(id);
+	for (int id = XMM0; id<=XMM15; id++)
+		if (destroyed[id])
+			regids.push_back(id);
+
+	return regids;
+}
@@ -5,17 +5,21 @@
 
 enum PlnX86_64Mnemonic {
 	COMMENT, LABEL,
-	ADDQ, ADDSS, ADDSD,
-	ANDQ,
+	ADDQ, ADDSS, ADDSD, ADDPS, ADDPD,
+	ANDQ, ANDPS, ANDPD, ANDNPS, ANDNPD,
+	BSFQ, BSRQ, BSWAPL, BSWAPQ, BTSQ,
 	CALL,
 	CLD,
 	CLTQ,
+	CMOVE, CMOVNE, CMOVL, CMOVG, CMOVLE, CMOVGE,
+	CMOVB, CMOVA, CMOVBE, CMOVAE,
 	CMP, CMPB, CMPW, CMPL, CMPQ,
+	CMPUNORDSS, CMPUNORDSD,
 	CQTO,
 	CVTSD2SS, CVTSI2SS, CVTSI2SD, CVTSS2SD,
 	CVTTSD2SI, CVTTSS2SI,
 	DECQ,
-	DIVSS, DIVSD, DIVQ,
+	DIVSS, DIVSD, DIVPS, DIVPD, DIVQ,
 	IDIVQ, IMULQ,
 	INCQ,
 	JA, JAE, JB, JBE,
@@ -25,22 +29,60 @@ enum PlnX86_64Mnemonic {
 	JL, JLE,
 	LEA,
 	LEAVE,
+	LZCNTQ,
+	MAXSS, MAXSD, MINSS, MINSD,
 	MOVABSQ,
 	MOVB, MOVW, MOVL, MOVQ,
+	MOVD, MOVDQA, MOVDQU,
+	MOVAPS, MOVUPS, MOVUPD,
+	MOVLHPS,
 	MOVSBQ, MOVSWQ, MOVSLQ,
 	MOVSS, MOVSD,
 	MOVZBQ, MOVZWQ,
-	MULSS, MULSD,
+	MULQ, MULSS, MULSD, MULPS, MULPD,
 	NEGQ,
+	ORPS, ORPD,
+	POPCNTQ,
 	POPQ, PUSHQ,
+	PADDD, PADDQ, PSUBD, PSUBQ,
+	PSRLDQ,
+	PUNPCKLDQ, PUNPCKLQDQ,
+	PXOR,
 	REP_MOVSQ, REP_MOVSL, REP_MOVSW, REP_MOVSB,
 	RET,
+	ROLB, ROLW, ROLL, ROLQ, RORB, RORW, RORL, RORQ,
+	RORXL, RORXQ,
+	ROUNDSS, ROUNDSD,
 	SALQ, SARQ, SHRQ,
 	SETE, SETNE, SETL, SETG, SETLE, SETGE,
 	SETB, SETA, SETBE, SETAE,
-	SUBQ, SUBSS, SUBSD,
+	SQRTSS, SQRTSD,
+	SUBQ, SUBSS, SUBSD, SUBPS, SUBPD,
 	SYSCALL,
+	TZCNTQ,
 	UCOMISD, UCOMISS,
+	UNPCKLPS, UNPCKLPD,
+	VADDSS, VADDSD, VSUBSS, VSUBSD,
+	VMULSS, VMULSD, VDIVSS, VDIVSD,
+	VMAXSS, VMAXSD, VMINSS, VMINSD,
+	VMOVSS, VMOVSD, VXORPS, VXORPD,
+	VCVTSD2SS, VCVTSS2SD, VCVTTSD2SI, VCVTTSS2SI,
+	VCVTSI2SS, VCVTSI2SD,
+	VUCOMISS, VUCOMISD,
+	VANDPS, VANDPD, VANDNPS, VANDNPD, VORPS, VORPD,
+	VCMPUNORDSS, VCMPUNORDSD,
+	VSQRTSS, VSQRTSD, VROUNDSS, VROUNDSD,
+	VMOVD, VMOVQ, VMOVDQA,
+	VMOVLHPS, VUNPCKLPS, VUNPCKLPD,
+	VPSRLDQ, VPUNPCKLDQ, VPUNPCKLQDQ, VPXOR,
+	VADDPS, VADDPD, VSUBPS, VSUBPD,
+	VMULPS, VMULPD, VDIVPS, VDIVPD,
+	VPADDD, VPADDQ, VPSUBD, VPSUBQ,
+	VBROADCASTSS, VBROADCASTSD, VPBROADCASTD, VPBROADCASTQ,
+	VMOVAPS, VMOVDQU, VMOVUPS, VMOVUPD,
+	VFMADD231SS, VFMADD231SD, VFNMADD231SS, VFNMADD231SD,
+	VFMSUB231SS, VFMSUB231SD,
+	VZEROUPPER,
 	XORPD, XORPS, XORQ,
 
 	MNE_SIZE,
@@ -116,10 +158,12 @@ public:
 	PlnX86_64RegisterMachine();
 	PlnX86_64RegisterMachine(const PlnX86_64RegisterMachine&) = delete;
 	void push(PlnX86_64Mnemonic mne, PlnOperandInfo *src=NULL, PlnOperandInfo* dst=NULL, string comment="");
+	void push(PlnX86_64Mnemonic mne, PlnOperandInfo *src, PlnOperandInfo* src2, PlnOperandInfo* dst, string comment);
 	void reserve(int num);
 	void addComment(const string& comment);
-	void popOpecodes(ostream& os);
+	void popOpecodes(ostream& os, bool use_vex=false, bool omit_fp=false);
 	void memoRequestedStackSize(int size);
+	bool getDestroyRegs(const string& func_name, vector<int>& regids);
 };
 
 inline int regid_of(PlnOperandInfo *ope) {
@@ -3,14 +3,19 @@
 /// @file	PlnX86_64RegisterMachineImp.h
 /// @copyright	2019-2020 YAMAGUCHI Toshinobu 
 
+#include <map>
+
 class PlnOpeCode {
 public:
 	PlnX86_64Mnemonic mne;
 	PlnOperandInfo *src, *dst;
+	PlnOperandInfo *src2;	// Second source of VEX 3 operands form. e.g.) vfmadd231sd src, src2, dst
 	string comment;
 	int mark;
 	PlnOpeCode(PlnX86_64Mnemonic mne, PlnOperandInfo *src, PlnOperandInfo* dst, string comment)
-		: mne(mne), src(src), dst(dst), comment(comment), mark(0) {}
+		: mne(mne), src(src), dst(dst), src2(NULL), comment(comment), mark(0) {}
+	PlnOpeCode(PlnX86_64Mnemonic mne, PlnOperandInfo *src, PlnOperandInfo *src2, PlnOperandInfo* dst, string comment)
+		: mne(mne), src(src), dst(dst), src2(src2), comment(comment), mark(0) {}
 };
 
 class PlnX86_64RegisterMachineImp
@@ -20,6 +25,7 @@ public:
 	int ret_num = 0;
 	int requested_stack_size = 0;
 	vector<PlnOpeCode> opecodes;
+	std::map<string, vector<int>> func_destroy_regs;	// Caller saved registers that generated function destroys.
 	PlnX86_64RegisterMachineImp() {
 	};
 };
@@ -10,11 +10,17 @@
 #include "PlnBlock.h"
 #include "../PlnScopeStack.h"
 #include "../PlnGenerator.h"
+#include "../PlnDataAllocator.h"
+#include "PlnType.h"
+#include "PlnVariable.h"
 #include "expressions/PlnCmpOperation.h"
+#include "expressions/PlnAssignment.h"
 
 PlnIfStatement::PlnIfStatement
 	(PlnExpression* condition, PlnBlock* block, PlnStatement* next, PlnBlock* parent)
-	: cond_dp(NULL), jmp_next_id(-1), jmp_end_id(-1), next(next)
+	: cond_dp(NULL), jmp_next_id(-1), jmp_end_id(-1), next(next),
+	  branchless(BL_NONE), dst_ex(NULL), acm_ex(NULL), second_ex(NULL), own_ex(NULL),
+	  acm_dp(NULL), second_dp(NULL), dst_dp(NULL)
 {
 	type = ST_IF;
 	inf.block = block;
@@ -30,6 +36,7 @@ PlnIfStatement::~PlnIfStatement()
 	delete inf.block;
 	if (next)
 		delete next;
+	delete own_ex;
 }
 
 void PlnIfStatement::finish(PlnDataAllocator& da, PlnScopeInfo& si)
@@ -37,6 +44,11 @@ void PlnIfStatement::finish(PlnDataAllocator& da, PlnScopeInfo& si)
 	BOOST_ASSERT(si.scope[0].type == SC_MODULE);
 	PlnModule* m = si.scope[0].inf.module;
 
+	if (setBranchless()) {
+		finishBranchless(da, si);
+		return;
+	}
+
 	jmp_next_id = m->getJumpID();
 
 	condition->jmp_if = 0;
@@ -60,6 +72,11 @@ void PlnIfStatement::finish(PlnDataAllocator& da, PlnScopeInfo& si)
 
 void PlnIfStatement::gen(PlnGenerator& g)
 {
+	if (branchless != BL_NONE) {
+		genBranchless(g);
+		return;
+	}
+
 	condition->gen(g);
 	inf.block->gen(g);
 
@@ -75,3 +92,184 @@ void PlnIfStatement::gen(PlnGenerator& g)
 	}
 }
 
+
+// Branchless assignment
+static PlnAssignment* getSingleAssignment(PlnBlock* block)
+{
+	if (block->statements.size() != 1 || block->variables.size())
+		return NULL;
+
+	PlnStatement* stmt = block->statements[0];
+	if (stmt->type != ST_EXPRSN || stmt->inf.expression->type != ET_ASSIGN)
+		return NULL;
+
+	auto asgn = static_cast<PlnAssignment*>(stmt->inf.expression);
+	if (asgn->lvals.size() != 1 || asgn->expressions.size() != 1)
+		return NULL;
+
+	return asgn;
+}
+
+static bool isDirectVar(PlnExpression* ex)
+{
+	if (ex->type != ET_VALUE || ex->values[0].type != VL_VAR)
+		return false;
+	if (ex->values[0].inf.var->is_indirect)
+		return false;
+
+	int dt = ex->getDataType();
+	return dt == DT_SINT || dt == DT_UINT || dt == DT_FLOAT;
+}
+
+// Side effect free integer value.
+static bool isSimpleIntValue(PlnExpression* ex)
+{
+	if (ex->type != ET_VALUE)
+		return false;
+	int vtype = ex->values[0].type;
+	if (vtype == VL_LIT_INT8 || vtype == VL_LIT_UINT8)
+		return true;
+
+	return isDirectVar(ex) && ex->getDataType() != DT_FLOAT;
+}
+
+static bool isSameVar(PlnExpression* ex1, PlnExpression* ex2)
+{
+	return isDirectVar(ex1) && isDirectVar(ex2)
+		&& ex1->values[0].inf.var == ex2->values[0].inf.var;
+}
+
+bool PlnIfStatement::setBranchless()
+{
+	if (condition->type != ET_CMP)
+		return false;
+
+	if (next && next->type != ST_BLOCK)
+		return false;
+
+	PlnAssignment* then_asgn = getSingleAssignment(inf.block);
+	if (!then_asgn)
+		return false;
+
+	PlnExpression* dst = then_asgn->lvals[0];
+	PlnExpression* then_val = then_asgn->expressions[0];
+	PlnExpression* else_val = NULL;
+
+	if (!isDirectVar(dst))
+		return false;
+
+	if (next) {
+		PlnAssignment* else_asgn = getSingleAssignment(next->inf.block);
+		if (!else_asgn || !isSameVar(dst, else_asgn->lvals[0]))
+			return false;
+		else_val = else_asgn->expressions[0];
+	}
+
+	auto cmp = static_cast<PlnCmpOperation*>(condition);
+	if (dst->getDataType() == DT_FLOAT) {
+		// e.g.) if a < b { a -> m } else { b -> m }  => minsd
+		//       if a < m { a -> m } => minsd
+		if (!else_val)
+			else_val = dst;
+
+		if (cmp->is_not || (cmp->cmp_type != CMP_L && cmp->cmp_type != CMP_G))
+			return false;
+
+		PlnExpression *p = cmp->l, *q = cmp->r;
+		if (!isDirectVar(p) || !isDirectVar(q) || isSameVar(p, q))
+			return false;
+
+		int size = dst->values[0].getVarType()->size();
+		for (auto ex: {p, q})
+			if (ex->getDataType() != DT_FLOAT || ex->values[0].getVarType()->size() != size)
+				return false;
+
+		bool then_is_p;
+		if (isSameVar(then_val, p) && isSameVar(else_val, q)) then_is_p = true;
+		else if (isSameVar(then_val, q) && isSameVar(else_val, p)) then_is_p = false;
+		else return false;
+
+		// minsd: (then < else) ? then : else
+		branchless = ((cmp->cmp_type == CMP_L) == then_is_p) ? BL_MIN : BL_MAX;
+		acm_ex = then_val;
+		second_ex = else_val;
+
+	} else {
+		// e.g.) if a < b { a -> m } else { 0 -> m } => cmovl
+		if (cmp->l->getDataType() == DT_FLOAT || cmp->r->getDataType() == DT_FLOAT)
+			return false;
+
+		if (!isSimpleIntValue(then_val))
+			return false;
+
+		if (else_val) {
+			if (!isSimpleIntValue(else_val))
+				return false;
+		} else {
+			own_ex = new PlnExpression(dst->values[0].inf.var);
+			else_val = own_ex;
+		}
+
+		branchless = BL_CMOV;
+		acm_ex = else_val;
+		second_ex = then_val;
+	}
+
+	dst_ex = dst;
+	return true;
+}
+
+void PlnIfStatement::finishBranchless(PlnDataAllocator& da, PlnScopeInfo& si)
+{
+	if (branchless == BL_CMOV) {
+		// Only set flags.
+		condition->jmp_if = -1;
+		condition->finish(da, si);
+	}
+
+	PlnVarType* dst_type = dst_ex->values[0].getVarType();
+	if (branchless == BL_CMOV)
+		acm_dp = da.prepareAccumulator(dst_type->data_type(), 8);
+	else
+		acm_dp = da.prepareAccumulator(DT_FLOAT, dst_type->size());
+	second_dp = second_ex->values[0].getDataPlace(da);
+
+	acm_ex->data_places.push_back(acm_dp);
+	acm_ex->finish(da, si);
+	second_ex->data_places.push_back(second_dp);
+	second_ex->finish(da, si);
+
+	da.popSrc(second_dp);
+	da.popSrc(acm_dp);
+	da.releaseDp(second_dp);
+
+	dst_dp = dst_ex->values[0].getDataPlace(da);
+	da.pushSrc(dst_dp, acm_dp);
+	da.popSrc(dst_dp);
+	da.releaseDp(dst_dp);
+}
+
+void PlnIfStatement::genBranchless(PlnGenerator& g)
+{
+	if (branchless == BL_CMOV)
+		condition->gen(g);
+
+	acm_ex->gen(g);
+	second_ex->gen(g);
+
+	g.genLoadDp(second_dp);
+	g.genLoadDp(acm_dp);
+
+	auto acme = g.getEntity(acm_dp);
+	auto se = g.getEntity(second_dp);
+
+	if (branchless == BL_CMOV) {
+		int cmp_type = static_cast<PlnCmpOperation*>(condition)->gen_cmp_type;
+		g.genCondMove(acme.get(), se.get(), cmp_type, "if " + second_dp->cmt());
+	} else {
+		g.genMinMax(acme.get(), se.get(), branchless == BL_MIN,
+			(branchless == BL_MIN ? "min(" : "max(") + acm_dp->cmt() + ", " + second_dp->cmt() + ")");
+	}
+
+	g.genLoadDp(dst_dp);
+}
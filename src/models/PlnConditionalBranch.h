@@ -1,7 +1,7 @@
 /// Conditi Branch model classes declaration.
 ///
 /// @file	PlnConditionalBranch.h
-/// @copyright	2018-2020 YAMAGUCHI Toshinobu 
+/// @copyright	2018-2022 YAMAGUCHI Toshinobu 
 
 #include "PlnStatement.h"
 
@@ -14,11 +14,26 @@ public:
 	PlnDataPlace* cond_dp;
 	PlnStatement* next;
 
+	// Branchless assignment. e.g.) if a < b { a -> m } else { b -> m }
+	enum {
+		BL_NONE,
+		BL_CMOV,	// cmovcc
+		BL_MIN,	// minss/minsd
+		BL_MAX	// maxss/maxsd
+	} branchless;
+	PlnExpression *dst_ex, *acm_ex, *second_ex, *own_ex;
+	PlnDataPlace *acm_dp, *second_dp, *dst_dp;
+
 	PlnIfStatement(PlnExpression* condition, PlnBlock* block, PlnStatement* next, PlnBlock* parent);
 	PlnIfStatement(const PlnIfStatement &) = delete;
 	~PlnIfStatement();
 
 	void finish(PlnDataAllocator& da, PlnScopeInfo& si) override;
 	void gen(PlnGenerator& g) override;
+
+private:
+	bool setBranchless();
+	void finishBranchless(PlnDataAllocator& da, PlnScopeInfo& si);
+	void genBranchless(PlnGenerator& g);
 };
 
@@ -25,6 +25,10 @@ enum PlnExprsnType {
 	ET_STRUCTMEMBER,
 	ET_REFVALUE,
 	ET_MCOPY,
+	ET_PTRTABLE,
+	ET_VECLOOP,
+	ET_FMA,
+	ET_INTRINSIC,
 	ET_TRUE,
 	ET_FALSE,
 	ET_VOID
@@ -10,6 +10,7 @@
 #include <boost/assert.hpp>
 #include <boost/archive/iterators/base64_from_binary.hpp>
 #include <functional>
+#include <algorithm>
 #include "../PlnConstants.h"
 #include "../PlnDataAllocator.h"
 #include "../PlnGenerator.h"
@@ -22,6 +23,7 @@
 #include "types/PlnFixedArrayType.h"
 #include "types/PlnStructType.h"
 #include "PlnVariable.h"
+#include "expressions/PlnStructMember.h"
 #include "../PlnMessage.h"
 #include "../PlnException.h"
 
@@ -106,6 +108,50 @@ PlnVariable* PlnFunction::addParam(const string& pname, PlnVarType* ptype, int i
 	return	param_var;
 }
 
+// Pass the small struct by value in registers instead of clone. (System V ABI)
+// e.g.) func f(Vec2 v) => v.x: %xmm0, v.y: %xmm1
+// The parameter of escape_params keeps clone because its ownership moves out.
+void PlnFunction::setByValStructs(const vector<string>& escape_params)
+{
+	BOOST_ASSERT(type == FT_PLN || type == FT_C);
+	int index = 0;
+	for (auto p: parameters) {
+		p->index = index;
+		PlnVarType* t = p->var->var_type;
+		if (p->passby == FPM_IN_BYREF_CLONE && t->typeinf->type == TP_STRUCT) {
+			auto st = static_cast<PlnStructTypeInfo*>(t->typeinf);
+			bool is_returned = false;
+			for (auto& rv: return_vals)
+				if (rv.local_var == p->var)
+					is_returned = true;
+
+			bool is_escape = std::find(escape_params.begin(), escape_params.end(), p->var->name) != escape_params.end();
+
+			if (st->eightbytes.size() && !is_returned && !is_escape) {
+				p->byval_struct = st;
+				index += st->eightbytes.size();
+				if (type == FT_PLN) {	// Callee place it on the stack.
+					string mode = t->mode;
+					mode[ALLOC_MD] = 's';
+					p->var->var_type = t->getVarType(mode);
+				}
+				continue;
+			}
+		}
+		index++;
+	}
+
+	// The return value of C function is copied to heap object by caller.
+	if (type == FT_C && return_vals.size() == 1) {
+		PlnVarType* t = return_vals[0].var_type;
+		if (t->typeinf->type == TP_STRUCT && t->mode[ALLOC_MD] == 'h') {
+			auto st = static_cast<PlnStructTypeInfo*>(t->typeinf);
+			if (st->eightbytes.size())
+				byval_ret_struct = st;
+		}
+	}
+}
+
 string PlnFunction::getParamStr(PlnVarType* vtype, PlnPassingMethod passby)
 {
 	string pname = vtype->tname();
@@ -157,7 +203,17 @@ vector<PlnDataPlace*> PlnFunction::createArgDps()
 	vector<PlnDataPlace*> arg_dps;
 
 	for (auto p: parameters) {
-		if (p->var->name != "...") {
+		if (p->byval_struct) {
+			auto &eightbytes = p->byval_struct->eightbytes;
+			for (auto eb: eightbytes) {
+				PlnDataPlace* dp = new PlnDataPlace(eb->type->size(), eb->type->data_type());
+				dp->status = DS_READY_ASSIGN;
+				dp->data.bytes.parent_dp = NULL;
+				arg_dps.push_back(dp);
+			}
+			arg_dps[p->index]->struct_parts = eightbytes.size();
+
+		} else if (p->var->name != "...") {
 			PlnVarType* var_type = p->var->var_type;
 			int data_type = var_type->data_type();
 			int data_size = var_type->size();
@@ -178,6 +234,17 @@ vector<PlnDataPlace*> PlnFunction::createArgDps()
 vector<PlnDataPlace*> PlnFunction::createRetValDps()
 {
 	vector<PlnDataPlace*> dps;
+	if (byval_ret_struct) {
+		for (auto eb: byval_ret_struct->eightbytes) {
+			PlnDataPlace* dp = new PlnDataPlace(eb->type->size(), eb->type->data_type());
+			dp->status = DS_READY_ASSIGN;
+			dp->data.bytes.parent_dp = NULL;
+			dps.push_back(dp);
+		}
+		dps[0]->struct_parts = dps.size();
+		return dps;
+	}
+
 	for (auto& rt: return_vals) {
 		PlnDataPlace* dp = new PlnDataPlace(rt.local_var->var_type->size(), rt.local_var->var_type->data_type());
 		dp->status = DS_READY_ASSIGN;
@@ -248,6 +315,24 @@ void PlnFunction::finish(PlnDataAllocator& da, PlnScopeInfo& si)
 					si.push_owner_var(p->var);
 
 				PlnVarType *t = p->var->var_type;
+				if (p->byval_struct) {
+					// Store each parts in registers to the struct on the stack.
+					p->var->place = da.allocData(t->size(), t->data_type());
+					p->var->place->comment = &p->var->name;
+					for (auto eb: p->byval_struct->eightbytes) {
+						auto part_ex = new PlnStructMember(new PlnExpression(p->var), eb);
+						auto part_dp = part_ex->values[0].getDataPlace(da);
+						da.pushSrc(part_dp, arg_dps[i]);
+						part_ex->finish(da, si);
+						da.popSrc(part_dp);
+						da.releaseDp(part_dp);
+						struct_param_exs.push_back(part_ex);
+						i++;
+					}
+					for_release.push_back(p->var);
+					continue;
+				}
+
 				auto dp = da.prepareLocalVar(t->size(), t->data_type());
 				dp->comment = &p->var->name;
 
@@ -324,11 +409,23 @@ void PlnFunction::gen(PlnGenerator &g)
 			g.genEntryFunc();		
 			g.genLocalVarArea(inf.pln.stack_size);		
  
+			auto part_ex = struct_param_exs.begin();
 			for (auto p: parameters) {
+				if (p->byval_struct) {
+					for (auto eb: p->byval_struct->eightbytes) {
+						(*part_ex)->gen(g);
+						g.genLoadDp((*part_ex)->values[0].inf.var->place);
+						part_ex++;
+					}
+					continue;
+				}
 				// no genSaveSrc because always save_place == NULL.
 				g.genLoadDp(p->var->place);
 			}
 
+			if (tail_jmp_id >= 0)
+				g.genJumpLabel(tail_jmp_id, "tail recursion");
+
 			if (retval_init)
 				retval_init->gen(g);
 
@@ -336,6 +433,10 @@ void PlnFunction::gen(PlnGenerator &g)
 			
 			implement->gen(g);
 			g.genEndFunc();
+
+			// Callers generated after this can keep the values on other registers.
+			if (do_opti_regalloc)
+				has_destroy_regs = g.getDestroyRegs(asm_name, destroy_regs);
 			break;
 		}
 
@@ -354,6 +455,9 @@ void PlnFunction::clear()
 		delete implement;
 		implement = NULL;
 	}
+	for (auto ex: struct_param_exs)
+		delete ex;
+	struct_param_exs.clear();
 	parent = NULL;
 }
 
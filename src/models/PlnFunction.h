@@ -5,6 +5,8 @@
 
 #include "../PlnModel.h"
 
+class PlnStructTypeInfo;
+
 enum PlnPassingMethod {
 	FPM_UNKNOWN,
 
@@ -30,9 +32,10 @@ class PlnParameter {
 public:
 	PlnVariable* var;
 	PlnExpression* dflt_value;
-	int index;
+	int index;	// of argument data places.
 	int iomode;
 	PlnPassingMethod passby;
+	PlnStructTypeInfo* byval_struct = NULL;	// Small struct passed in registers instead of clone.
 };
 
 class PlnReturnValue {
@@ -70,11 +73,19 @@ public:
 	bool generated;
 	bool do_opti_regalloc = true;
 	bool never_return = false;
+	PlnFunction* ret_storage_func = NULL;	// Variant that takes caller's variable as return value.
+	vector<PlnExpression*> struct_param_exs;	// Store each parts of byval_struct param.
+	PlnStructTypeInfo* byval_ret_struct = NULL;	// Small struct returned in registers. (C function only)
+	vector<PlnFunction*> callees;	// Palan functions called directly. Generated before this function.
+	bool has_destroy_regs = false;	// Registers destroyed by this function is known.
+	vector<int> destroy_regs;
+	int tail_jmp_id = -1;	// Head of the function to jump at self tail recursion.
 
 	PlnFunction(int func_type, const string& func_name);
 	PlnVariable* addRetValue(const string& rname, PlnVarType* rtype);
 	PlnVariable* addParam(const string& pname, PlnVarType* ptype, int iomode, PlnPassingMethod pass_method, PlnExpression* defaultVal);
 
+	void setByValStructs(const vector<string>& escape_params);
 	vector<string> getParamStrs() const;
 	vector<PlnDataPlace*> createArgDps();
 	vector<PlnDataPlace*> createRetValDps();
@@ -11,9 +11,12 @@
 #include "../PlnScopeStack.h"
 #include "../PlnGenerator.h"
 #include "expressions/PlnCmpOperation.h"
+#include "expressions/PlnAddOperation.h"
+#include "expressions/PlnMulOperation.h"
+#include "expressions/PlnDivOperation.h"
 
 PlnWhileStatement::PlnWhileStatement(PlnExpression* condition, PlnBlock* block, PlnBlock* parent)
-	: cond_dp(NULL), jmp_start_id(-1), jmp_end_id(-1)
+	: cond_dp(NULL), jmp_start_id(-1), jmp_cond_id(-1), jmp_end_id(-1), dup_cond(false)
 {
 	type = ST_WHILE;
 	block->owner_stmt = this;
@@ -28,26 +31,79 @@ PlnWhileStatement::~PlnWhileStatement()
 	delete inf.block;
 }
 
+// Code of the expression can be generated twice.
+// It should not have internal labels.
+static bool isDuplicatable(PlnExpression* e)
+{
+	switch (e->type) {
+		case ET_VALUE:
+			return true;
+		case ET_ADD: {
+			auto ae = static_cast<PlnAddOperation*>(e);
+			return isDuplicatable(ae->l) && isDuplicatable(ae->r);
+		}
+		case ET_MUL: {
+			auto me = static_cast<PlnMulOperation*>(e);
+			return isDuplicatable(me->l) && isDuplicatable(me->r);
+		}
+		case ET_DIV: {
+			auto de = static_cast<PlnDivOperation*>(e);
+			return isDuplicatable(de->l) && isDuplicatable(de->r);
+		}
+		case ET_CMP: {
+			auto ce = static_cast<PlnCmpOperation*>(e);
+			return isDuplicatable(ce->l) && isDuplicatable(ce->r);
+		}
+		case ET_TRUE:
+		case ET_FALSE:
+			return true;
+		default:
+			return false;
+	}
+}
+
 void PlnWhileStatement::finish(PlnDataAllocator& da, PlnScopeInfo& si)
 {
 	BOOST_ASSERT(si.scope[0].type == SC_MODULE);
 	PlnModule* m = si.scope[0].inf.module;
 
 	jmp_start_id = m->getJumpID();
+	jmp_cond_id = m->getJumpID();
 	jmp_end_id = m->getJumpID();
 
-	condition->jmp_if = 0;
-	condition->jmp_id = jmp_end_id;
+	// Rotate loop to test condition at the bottom.
+	// Simple condition is duplicated to guard the loop.
+	// Otherwise jump to the bottom condition at first.
+	dup_cond = isDuplicatable(condition);
+	if (dup_cond) {
+		condition->jmp_if = 0;
+		condition->jmp_id = jmp_end_id;
+	} else {
+		condition->jmp_if = 1;
+		condition->jmp_id = jmp_start_id;
+	}
 	condition->finish(da, si);
 	inf.block->finish(da, si);
 }
 
 void PlnWhileStatement::gen(PlnGenerator& g)
 {
+	if (dup_cond)
+		condition->gen(g);
+	else
+		g.genJump(jmp_cond_id, "");
+
 	g.genJumpLabel(jmp_start_id, "while");
-	condition->gen(g);
 	inf.block->gen(g);
-	g.genJump(jmp_start_id, "");
+	g.genJumpLabel(jmp_cond_id, "while cond");
+
+	if (dup_cond) {
+		condition->jmp_if = 1;
+		condition->jmp_id = jmp_start_id;
+		condition->gen(g);
+	} else {
+		condition->gen(g);
+	}
 	g.genJumpLabel(jmp_end_id, "end while");
 }
 
@@ -98,7 +154,7 @@ PlnContinueStatement::PlnContinueStatement(PlnStatement* target_stmt)
 void PlnContinueStatement::finish(PlnDataAllocator& da, PlnScopeInfo& si)
 {
 	if (target_stmt->type == ST_WHILE) {
-		jmp_id = static_cast<PlnWhileStatement*>(target_stmt)->jmp_start_id;
+		jmp_id = static_cast<PlnWhileStatement*>(target_stmt)->jmp_cond_id;
 	} else
 		BOOST_ASSERT(false);
 		
@@ -11,7 +11,8 @@ class PlnWhileStatement : public PlnStatement
 public:
 	PlnBoolExpression* condition;
 
-	int jmp_start_id, jmp_end_id;
+	int jmp_start_id, jmp_cond_id, jmp_end_id;
+	bool dup_cond;	// true: guard with duplicated condition, false: jump to bottom condition.
 	PlnDataPlace* cond_dp;
 
 	PlnWhileStatement(PlnExpression* condition, PlnBlock* block, PlnBlock* parent);
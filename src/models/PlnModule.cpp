@@ -6,6 +6,7 @@
 /// @file	PlnModule.cpp
 /// @copyright	2017-2020 YAMAGUCHI Toshinobu 
 
+#include <algorithm>
 #include <boost/assert.hpp>
 #include "../PlnConstants.h"
 #include "../PlnDataAllocator.h"
@@ -18,6 +19,7 @@
 #include "PlnVariable.h"
 #include "PlnStatement.h"
 #include "PlnType.h"
+#include "expressions/PlnFunctionCall.h"
 
 using namespace std;
 
@@ -40,6 +42,19 @@ int PlnModule::getJumpID()
 	return ++max_jmp_id;
 }
 
+static PlnFunction* findFirstGenFunc(PlnFunction* f, vector<PlnFunction*> &path)
+{
+	path.push_back(f);
+	for (auto callee: f->callees) {
+		if (callee->generated || !callee->implement)
+			continue;
+		if (std::find(path.begin(), path.end(), callee) != path.end())	// recursive call
+			continue;
+		return findFirstGenFunc(callee, path);
+	}
+	return f;
+}
+
 void PlnModule::gen(PlnDataAllocator& da, PlnGenerator& g)
 {
 	for (auto f : functions)
@@ -48,6 +63,9 @@ void PlnModule::gen(PlnDataAllocator& da, PlnGenerator& g)
 	PlnScopeInfo si;
 	si.scope.push_back(PlnScopeItem(this));
 
+	PlnFunctionCall::getInternalFunc(IFUNC_MALLOC)->asm_name = use_pool_alloc ? "__pln_alloc" : "malloc";
+	PlnFunctionCall::getInternalFunc(IFUNC_FREE)->asm_name = use_pool_alloc ? "__pln_free" : "free";
+
 	g.genSecReadOnlyData();
 	g.genSecText();
 
@@ -84,6 +102,12 @@ void PlnModule::gen(PlnDataAllocator& da, PlnGenerator& g)
 		}
 
 		if (!f) break;
+
+		// Generate the callee first to know the registers it destroys.
+		if (do_opti_regalloc) {
+			vector<PlnFunction*> path;
+			f = findFirstGenFunc(f, path);
+		}
 		
 		f->do_opti_regalloc = do_opti_regalloc;
 
@@ -104,6 +128,9 @@ void PlnModule::gen(PlnDataAllocator& da, PlnGenerator& g)
 		}
 	}
 	
+	if (use_pool_alloc)
+		g.genPoolAllocator(pool_alloc_stats);
+
 	BOOST_ASSERT(si.scope.size() == 1);
 	BOOST_ASSERT(si.owner_vars.size() == 0);
 
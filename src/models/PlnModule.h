@@ -15,7 +15,22 @@ public:
 	PlnBlock* toplevel;
 	int max_jmp_id;
 	bool do_opti_regalloc = true;
+	int stack_alloc_limit = 0;	// Max size of object allocated on stack automatically.
+	bool do_auto_move = false;	// Move ownership instead of copy at last use.
+	bool do_ret_storage = false;	// Construct object return value in caller's variable.
+	bool do_contiguous_alloc = false;	// Allocate nested arrays in one block.
+	bool do_region_alloc = false;	// Allocate large local objects in the region of block.
+	bool do_rodata_bind = false;	// Bind read only arrays to the literal data directly.
+	bool do_vectorize = false;	// Process simple loops of arrays by packed instructions.
+	bool do_fp_contract = false;	// Fuse float multiply and add. (Not strict IEEE)
+	bool do_intrinsic = false;	// Process well-known C functions inline.
+	bool do_struct_byval = false;	// Pass small structs in registers instead of clone.
+	bool do_tail_call = false;	// Process self tail recursion as loop.
+	bool has_round_insn = false;	// Target has float rounding instruction. (e.g. SSE4.1)
+	bool use_pool_alloc = false;	// Use pool allocator instead of malloc/free. Not compatible with C malloc/free.
+	bool pool_alloc_stats = false;	// Output allocation counters at exit.
 	vector<PlnFunction*> functions;
+	vector<PlnVariable*> stack_alloc_vars;	// Objects allocated on stack automatically.
 
 	PlnModule();
 	PlnModule(const PlnModule&) = delete;
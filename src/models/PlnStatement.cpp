@@ -89,7 +89,7 @@ void PlnStatement::gen(PlnGenerator& g)
 
 // PlnReturnStmt
 PlnReturnStmt::PlnReturnStmt(vector<PlnExpression *>& retexp, PlnBlock* parent)
-	: expressions(move(retexp))
+	: expressions(move(retexp)), is_tail_loop(false)
 {
 	type = ST_RETURN;
 	this->parent = parent;
@@ -122,6 +122,16 @@ PlnReturnStmt::PlnReturnStmt(vector<PlnExpression *>& retexp, PlnBlock* parent)
 	}
 }
 
+// e.g.) return f(n-1, a*n); => n-1, a*n -> n, a; jump to head of f.
+PlnReturnStmt::PlnReturnStmt(PlnAssignment* param_asgn, PlnBlock* parent)
+	: expressions({param_asgn}), is_tail_loop(true)
+{
+	type = ST_RETURN;
+	this->parent = parent;
+	function = parent->parent_func;
+	BOOST_ASSERT(function && function->tail_jmp_id >= 0);
+}
+
 PlnReturnStmt::~PlnReturnStmt()
 {
 	for (auto e: expressions)
@@ -133,8 +143,10 @@ PlnReturnStmt::~PlnReturnStmt()
 void PlnReturnStmt::finish(PlnDataAllocator& da, PlnScopeInfo& si)
 {
 	BOOST_ASSERT(function->type == FT_PLN);
-	dps = function->createRetValDps();
-	da.setRetValDps(function->type, dps, true);
+	if (!is_tail_loop) {
+		dps = function->createRetValDps();
+		da.setRetValDps(function->type, dps, true);
+	}
 
 	vector<PlnVariable*> ret_vars;
 	
@@ -233,6 +245,11 @@ void PlnReturnStmt::gen(PlnGenerator& g)
 	for (auto free_var: free_vars)
 		free_var->gen(g);
 
+	if (is_tail_loop) {
+		g.genJump(function->tail_jmp_id, "tail recursion");
+		return;
+	}
+
 	for(auto dp: dps)
 		g.genLoadDp(dp, false);
 
@@ -39,6 +39,7 @@ public:
 };
 
 class PlnClone;
+class PlnAssignment;
 class PlnReturnStmt : public PlnStatement
 {
 public:
@@ -47,8 +48,10 @@ public:
 	vector<PlnClone*> clones;
 	vector<PlnDataPlace*> dps;
 	vector<PlnExpression*> free_vars;
+	bool is_tail_loop;	// Self tail recursion: assign arguments to parameters and jump to head.
 
 	PlnReturnStmt(vector<PlnExpression*> &retexp, PlnBlock* parent);	// throw PlnCompileError
+	PlnReturnStmt(PlnAssignment* param_asgn, PlnBlock* parent);
 	~PlnReturnStmt();
 
 	void finish(PlnDataAllocator& da, PlnScopeInfo& si) override;
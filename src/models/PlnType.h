@@ -59,6 +59,7 @@ class PlnVarType {
 public:
 	PlnTypeInfo* typeinf;
 	string mode;
+	PlnVarType* decl_type = NULL;	// Type written in the code when the compiler changed the allocation.
 
 	PlnVarType(PlnTypeInfo* typeinf, const string &mode): typeinf(typeinf), mode(mode) {}
 	virtual ~PlnVarType() {}
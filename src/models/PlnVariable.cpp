@@ -22,6 +22,7 @@
 #include "../PlnMessage.h"
 #include "../PlnException.h"
 #include "expressions/PlnFunctionCall.h"
+#include "expressions/PlnAddOperation.h"
 #include "expressions/assignitem/PlnAssignItem.h"
 
 // PlnVarInit
@@ -125,7 +126,14 @@ PlnVarInit::PlnVarInit(vector<PlnValue>& vars, vector<PlnExpression*> *inits)
 		PlnVariable* v = vars[i].inf.var;
 		if (v->var_type->mode[ALLOC_MD] == 'h') {
 			PlnExpression* alloc_ex = NULL;
-			if (i >= init_var_i || vars[i].asgn_type == ASGN_COPY) {
+			if (v->is_contiguous) {
+				BOOST_ASSERT(i >= init_var_i);
+				PlnExpression* ptr_init_ex;
+				alloc_ex = static_cast<PlnFixedArrayVarType*>(v->var_type)->getContiguousAllocEx(v, ptr_init_ex);
+				varinits.push_back({v, alloc_ex, ptr_init_ex});
+				continue;
+
+			} else if (i >= init_var_i || vars[i].asgn_type == ASGN_COPY) {
 				vector<PlnExpression*> alloc_args;
 				v->var_type->getAllocArgs(alloc_args);
 				alloc_ex = v->var_type->getAllocEx(alloc_args);
@@ -137,6 +145,14 @@ PlnVarInit::PlnVarInit(vector<PlnValue>& vars, vector<PlnExpression*> *inits)
 			}
 			varinits.push_back({v, alloc_ex, NULL});
 
+		} else if (v->region_offset >= 0) {
+			// Point to the place in the region of the block.
+			BOOST_ASSERT(v->container && i >= init_var_i);
+			PlnExpression *alloc_ex = new PlnExpression(v->container);
+			if (v->region_offset)
+				alloc_ex = new PlnAddOperation(alloc_ex, new PlnExpression(uint64_t(v->region_offset)));
+			varinits.push_back({v, alloc_ex, NULL});
+
 		} else if (v->var_type->data_type() == DT_OBJECT) {
 			vector<PlnExpression *> args;
 			v->var_type->getAllocArgs(args);
@@ -151,9 +167,12 @@ PlnVarInit::PlnVarInit(vector<PlnValue>& vars, vector<PlnExpression*> *inits)
 
 PlnVarInit::~PlnVarInit()
 {
-	for (auto vi: varinits)
+	for (auto vi: varinits) {
 		if (vi.alloc_ex)
 			delete vi.alloc_ex;
+		if (vi.internal_alloc_ex)
+			delete vi.internal_alloc_ex;
+	}
 
 	for (auto ai: assgin_items)
 		delete ai;
@@ -168,7 +187,10 @@ void PlnVarInit::finish(PlnDataAllocator& da, PlnScopeInfo& si)
 		auto t = v->var_type;
 		BOOST_ASSERT(t->mode[ALLOC_MD] != 'i');
 		if (t->mode[ALLOC_MD] == 's') {
-			v->place = da.allocData(t->size(), t->data_type());
+			int size = t->size();
+			if (size < 8 && (size & (size-1)))	// e.g.) $[3]int16
+				size = 8;
+			v->place = da.allocData(size, t->data_type());
 		} else {	// h: Heap or r: Refernce
 			v->place = da.allocData(8, DT_OBJECT_REF);
 		}
@@ -208,7 +230,8 @@ void PlnVarInit::gen(PlnGenerator& g)
 		if (auto ex = vi.alloc_ex) {
 			ex->gen(g);
 			g.genLoadDp(ex->data_places[0]);
-		} else if (auto ex = vi.internal_alloc_ex) {
+		}
+		if (auto ex = vi.internal_alloc_ex) {
 			ex->gen(g);
 		}
 	}
@@ -221,6 +244,10 @@ void PlnVarInit::gen(PlnGenerator& g)
 
 PlnExpression* PlnVariable::getFreeEx()
 {
+	if (is_contiguous) {	// Items are in the same block.
+		vector<PlnExpression*> free_args = { new PlnExpression(this) };
+		return new PlnFunctionCall(PlnFunctionCall::getInternalFunc(IFUNC_FREE), free_args);
+	}
 	return var_type->getFreeEx(new PlnExpression(this));
 }
 
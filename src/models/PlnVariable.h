@@ -14,6 +14,8 @@ public:
 	bool is_tmpvar;
 	bool is_indirect;
 	bool is_global;
+	bool is_contiguous;	// Nested arrays are allocated in one block.
+	int64_t region_offset;	// Offset in the block region (container). -1: not in region.
 
 	struct {
 		vector<PlnExpression*> *sizes;
@@ -22,7 +24,7 @@ public:
 	PlnLoc loc;
 
 	PlnVariable(): var_type(NULL), place(NULL), container(NULL),
-		is_tmpvar(false), is_indirect(false), is_global(false) {}
+		is_tmpvar(false), is_indirect(false), is_global(false), is_contiguous(false), region_offset(-1) {}
 
 	PlnExpression* getFreeEx();
 	PlnExpression* getInternalFreeEx();
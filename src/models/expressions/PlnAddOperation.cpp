@@ -21,8 +21,11 @@
 // PlnAddOperation
 PlnExpression* PlnAddOperation::create(PlnExpression* l, PlnExpression* r)
 {
-	if (l->getDataType() == DT_OBJECT_REF || r->getDataType() == DT_OBJECT_REF) {
-		auto exp = (l->getDataType() == DT_OBJECT_REF) ? l : r;
+	auto is_object = [](PlnExpression* e) {
+		return e->getDataType() == DT_OBJECT_REF || e->getDataType() == DT_OBJECT;
+	};
+	if (is_object(l) || is_object(r)) {
+		auto exp = is_object(l) ? l : r;
 		string tname = exp->values[0].getVarType()->tname();
 		PlnCompileError err(E_CantUseOperatorHere, tname);
 		err.loc = exp->loc;
@@ -30,6 +30,8 @@ static bool didUpdate(PlnVariable* var, PlnExpression* e) {
 		case ET_CHAINCALL:
 		case ET_ADD:
 		case ET_MUL:
+		case ET_FMA:
+		case ET_INTRINSIC:
 		case ET_DIV:
 		case ET_NEG:
 		case ET_CMP:
@@ -12,6 +12,7 @@
 #include "../../PlnDataAllocator.h"
 #include "../../PlnGenerator.h"
 #include "../PlnType.h"
+#include "../PlnVariable.h"
 
 
 #define CREATE_CHECK_FLAG(ex)	bool is_##ex##_int = false, is_##ex##_uint = false, is_##ex##_flo = false;	\
@@ -93,7 +94,7 @@ PlnExpression* PlnCmpOperation::create(PlnExpression* l, PlnExpression* r, PlnCm
 }
 
 PlnCmpOperation::PlnCmpOperation(PlnExpression* l, PlnExpression* r, PlnCmpType cmp_type)
-	: PlnBoolExpression(ET_CMP), l(l), r(r), cmp_type(cmp_type), result_dp(NULL)
+	: PlnBoolExpression(ET_CMP), l(l), r(r), cmp_type(cmp_type), gen_cmp_type(-1), result_dp(NULL)
 {
 	BOOST_ASSERT(!(l->type == ET_VALUE && l->values[0].type == VL_LIT_INT8));
 	PlnValue v;
@@ -109,6 +110,29 @@ PlnCmpOperation::~PlnCmpOperation()
 	delete r;
 }
 
+// Use cmp; jcc directly without loading 1st value to accumulator,
+// when the result only feeds a branch.
+bool PlnCmpOperation::isDirectCmp()
+{
+	if (data_places.size())
+		return false;
+
+	if (l->type != ET_VALUE || l->values[0].type != VL_VAR)
+		return false;
+
+	// Register may have not extended value.
+	PlnVariable* var = l->values[0].inf.var;
+	if (var->is_indirect || var->var_type->size() != 8)
+		return false;
+
+	int ldt = l->getDataType();
+	if (ldt != DT_SINT && ldt != DT_UINT)
+		return false;
+
+	// r should not have side effect to l.
+	return r->type == ET_VALUE && r->getDataType() != DT_FLOAT;
+}
+
 void PlnCmpOperation::finish(PlnDataAllocator& da, PlnScopeInfo& si)
 {
 	BOOST_ASSERT(data_places.size() <= 1);
@@ -118,7 +142,12 @@ void PlnCmpOperation::finish(PlnDataAllocator& da, PlnScopeInfo& si)
 	if (r->getDataType() == DT_FLOAT)
 		acm_data_type = DT_FLOAT;
 
-	ldp = da.prepareAccumulator(acm_data_type, 8);
+	if (isDirectCmp()) {
+		// Compare the variable directly. e.g.) cmp $10, -8(%rbp)
+		ldp = l->values[0].getDataPlace(da);
+	} else {
+		ldp = da.prepareAccumulator(acm_data_type, 8);
+	}
 
 	if (r->type == ET_VALUE) {
 		rdp = r->values[0].getDataPlace(da);
@@ -202,7 +231,7 @@ void PlnCmpOperation::gen(PlnGenerator& g)
 				 BOOST_ASSERT(false);
 	}
 
-	int gen_cmp_type = g.genCmp(le.get(), re.get(), actual_cmp_type, ldp->cmt() + cmp_str + rdp->cmt());
+	gen_cmp_type = g.genCmp(le.get(), re.get(), actual_cmp_type, ldp->cmt() + cmp_str + rdp->cmt());
 
 	if (data_places.size()) {
 		if (push_mode == -1) {
@@ -9,6 +9,7 @@ class PlnCmpOperation : public PlnBoolExpression
 {
 public:
 	PlnCmpType cmp_type;
+	int gen_cmp_type;	// Actual cmp type of generated code. Available after gen().
 
 	PlnDataPlace* result_dp;
 	PlnExpression* l;
@@ -21,5 +22,8 @@ public:
 	void gen(PlnGenerator& g) override;
 
 	static PlnExpression* create(PlnExpression* l, PlnExpression* r, PlnCmpType cmp_type);
+
+private:
+	bool isDirectCmp();
 };
 
@@ -0,0 +1,146 @@
+/// PlnFMAOperation Expression model class declaration.
+///
+/// Contracted float multiply and add without intermediate rounding.
+/// Created from add/sub operation only when fp-contract is enabled.
+/// e.g.) c + a * b, c - a * b, a * b - c
+///
+/// @file	PlnFMAOperation.h
+/// @copyright	2022 YAMAGUCHI Toshinobu
+
+#include "../PlnExpression.h"
+
+class PlnFMAOperation : public PlnExpression {
+public:
+	PlnExpression *c, *a, *b;
+	PlnDataPlace *cdp, *adp, *bdp;
+	bool a_is_temp, b_is_temp;
+	int fma_type;
+
+	PlnFMAOperation(PlnExpression* c, PlnExpression* a, PlnExpression* b, int fma_type, PlnVarType* type)
+		: c(c), a(a), b(b), cdp(NULL), adp(NULL), bdp(NULL),
+		  a_is_temp(false), b_is_temp(false), fma_type(fma_type), PlnExpression(ET_FMA)
+	{
+		PlnValue val;
+		val.type = VL_WORK;
+		val.inf.wk_type = type;
+		values.push_back(val);
+	}
+
+	~PlnFMAOperation() {
+		delete c;
+		delete a;
+		delete b;
+	}
+
+	// Return NULL when the operation is not contractable.
+	static PlnExpression* create(PlnExpression* add) {
+		if (add->type != ET_ADD || add->getDataType() != DT_FLOAT)
+			return NULL;
+
+		auto ae = static_cast<PlnAddOperation*>(add);
+		int fma_type;
+		PlnExpression *c;
+		PlnMulOperation *me;
+		if (isContractableMul(ae->r, add)) {	// c + a*b, c - a*b
+			c = ae->l;
+			me = static_cast<PlnMulOperation*>(ae->r);
+			fma_type = ae->is_add ? FMA_ADD : FMA_NADD;
+
+		} else if (isContractableMul(ae->l, add)) {	// a*b + c, a*b - c
+			c = ae->r;
+			me = static_cast<PlnMulOperation*>(ae->l);
+			fma_type = ae->is_add ? FMA_ADD : FMA_SUB;
+
+		} else
+			return NULL;
+
+		auto fma = new PlnFMAOperation(c, me->l, me->r, fma_type, add->values[0].getVarType());
+		me->l = me->r = NULL;
+		ae->l = ae->r = NULL;
+		delete me;
+		delete add;
+		return fma;
+	}
+
+	void finish(PlnDataAllocator& da, PlnScopeInfo& si) override {
+		PlnVarType* t = values[0].getVarType();
+		cdp = da.prepareAccumulator(DT_FLOAT, t->size());
+
+		// Multiplicands: direct var or temporary
+		adp = prepareOperandDp(da, a, a_is_temp);
+		a->finish(da, si);
+		if (a_is_temp) da.popSrc(adp);
+
+		bdp = prepareOperandDp(da, b, b_is_temp);
+		b->finish(da, si);
+		if (b_is_temp) da.popSrc(bdp);
+
+		c->data_places.push_back(cdp);
+		c->finish(da, si);
+
+		if (!a_is_temp) da.popSrc(adp);
+		if (!b_is_temp) da.popSrc(bdp);
+		da.popSrc(cdp);
+
+		da.releaseDp(adp);
+		auto result = da.added(cdp, bdp);
+
+		if (data_places.size())
+			da.pushSrc(data_places[0], result);
+		else
+			da.releaseDp(result);
+	}
+
+	void gen(PlnGenerator& g) override {
+		a->gen(g);
+		if (a_is_temp) g.genLoadDp(adp);
+		b->gen(g);
+		if (b_is_temp) g.genLoadDp(bdp);
+		c->gen(g);
+
+		if (!a_is_temp) g.genLoadDp(adp);
+		if (!b_is_temp) g.genLoadDp(bdp);
+		g.genLoadDp(cdp);
+
+		auto ce = g.getEntity(cdp);
+		auto ae = g.getEntity(adp);
+		auto be = g.getEntity(bdp);
+		string cmt = adp->cmt() + " * " + bdp->cmt();
+		if (fma_type == FMA_ADD) cmt = cdp->cmt() + " + " + cmt;
+		else if (fma_type == FMA_NADD) cmt = cdp->cmt() + " - " + cmt;
+		else cmt += " - " + cdp->cmt();
+		g.genFMA(ce.get(), ae.get(), be.get(), fma_type, cmt);
+
+		if (data_places.size())
+			g.genSaveSrc(data_places[0]);
+	}
+
+private:
+	static bool isContractableMul(PlnExpression* ex, PlnExpression* add) {
+		if (ex->type != ET_MUL || ex->getDataType() != DT_FLOAT)
+			return false;
+		if (ex->values[0].getVarType()->size() != add->values[0].getVarType()->size())
+			return false;
+
+		auto me = static_cast<PlnMulOperation*>(ex);
+		return me->l->getDataType() == DT_FLOAT && me->r->getDataType() == DT_FLOAT;
+	}
+
+	PlnDataPlace* prepareOperandDp(PlnDataAllocator& da, PlnExpression* ex, bool &is_temp) {
+		PlnDataPlace* dp;
+		PlnValue &v = ex->values[0];
+		if (ex->type == ET_VALUE && v.type == VL_VAR && !v.inf.var->is_indirect
+				&& v.getVarType()->size() == values[0].getVarType()->size()) {
+			dp = v.getDataPlace(da);
+			is_temp = false;
+
+		} else {
+			dp = da.prepareLocalVar(values[0].getVarType()->size(), DT_FLOAT);
+			static string cmt="(temp@fma)";
+			dp->comment = &cmt;
+			is_temp = true;
+		}
+		ex->data_places.push_back(dp);
+		return dp;
+	}
+};
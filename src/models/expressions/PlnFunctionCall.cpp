@@ -20,6 +20,8 @@
 #include "../../PlnScopeStack.h"
 #include "PlnClone.h"
 #include "PlnArrayValue.h"
+#include "PlnStructMember.h"
+#include "../types/PlnStructType.h"
 #include "../../PlnMessage.h"
 #include "../../PlnException.h"
 
@@ -28,7 +30,7 @@ static bool is_init_ifunc = false;
 
 // PlnFunctionCall
 PlnFunctionCall::PlnFunctionCall(PlnFunction* f)
-	: PlnExpression(ET_FUNCCALL), function(f)
+	: PlnExpression(ET_FUNCCALL), function(f), ret_struct_var(NULL), ret_alloc_ex(NULL), ret_free_ex(NULL)
 {
 	for (auto& rv: f->return_vals) {
 		PlnValue val;
@@ -68,12 +70,25 @@ PlnFunctionCall::~PlnFunctionCall()
 		delete fv;
 	for (auto fex: free_exs)
 		delete fex;
+	for (auto &sa: struct_args) {
+		for (auto pex: sa.part_exs)
+			delete pex;
+		delete sa.free_ex;
+		delete sa.clone;
+		delete sa.var;
+	}
+	for (auto pex: ret_part_exs)
+		delete pex;
+	delete ret_alloc_ex;
+	delete ret_free_ex;
+	delete ret_struct_var;
 }
 
 static vector<PlnDataPlace*> loadArgs(PlnFunctionCall *fcall, PlnDataAllocator& da, PlnScopeInfo& si)
 {
 	auto f = fcall->function;
 	auto& clones = fcall->clones;
+	auto& struct_args = fcall->struct_args;
 	auto arg_dps = f->createArgDps();
 
 	if (f->has_va_arg) {
@@ -113,7 +128,42 @@ static vector<PlnDataPlace*> loadArgs(PlnFunctionCall *fcall, PlnDataAllocator&
 			} 
 
 			PlnClone* clone = NULL;
-			if (argval.param->passby == FPM_IN_BYREF_CLONE) {
+			PlnStructArg sarg;
+			if (argval.param->byval_struct) {
+				// Get the address of the struct to load each parts to the registers.
+				if (v.type == VL_LIT_ARRAY) {
+					PlnExpression* tmp = v.inf.arrValue;
+					v.inf.arrValue = NULL;
+					delete arg.exp;
+					arg.exp = tmp;
+				}
+				PlnValue &sv = arg.exp->values[vi];
+
+				if (arg.exp->type == ET_VALUE && sv.type == VL_VAR) {
+					// Use the variable directly.
+
+				} else if (arg.exp->type == ET_ARRAYVALUE
+						&& !static_cast<PlnArrayValue*>(arg.exp)->doCopyFromStaticBuffer) {
+					sarg.clone = new PlnClone(da, arg.exp, argval.param->var->var_type->getVarType("--h"), true);
+					sarg.clone->finishAlloc(da, si);
+
+				} else if (sv.type == VL_WORK && sv.inf.wk_type->mode[ALLOC_MD] == 'h') {
+					// e.g.) f(g()): free the return value of g after call.
+					sarg.var = PlnVariable::createTempVar(da, sv.inf.wk_type, "(struct arg)");
+					arg.exp->data_places.push_back(sarg.var->place);
+					sarg.free_ex = sarg.var->getFreeEx();
+
+				} else {
+					sarg.var = PlnVariable::createTempVar(da, sv.getVarType()->getVarType("rir"), "(struct arg)");
+					arg.exp->data_places.push_back(sarg.var->place);
+				}
+
+				clones.push_back(NULL);
+				struct_args.push_back(sarg);
+				vi++;
+				continue;
+
+			} else if (argval.param->passby == FPM_IN_BYREF_CLONE) {
 				BOOST_ASSERT(v.type == VL_LIT_ARRAY || v.type == VL_VAR || v.type == VL_WORK || v.type == VL_LIT_STR);
 				if (v.type == VL_LIT_ARRAY) {
 					PlnExpression* tmp = v.inf.arrValue;
@@ -159,6 +209,7 @@ static vector<PlnDataPlace*> loadArgs(PlnFunctionCall *fcall, PlnDataAllocator&
 				arg.exp->data_places.push_back(arg_dps[dp_i]);
 
 			clones.push_back(clone);
+			struct_args.push_back(sarg);
 
 			vi++;
 		}
@@ -193,6 +244,31 @@ static vector<PlnDataPlace*> loadArgs(PlnFunctionCall *fcall, PlnDataAllocator&
 				clones[j]->finishCopy(da, si);
 				clones[j]->finish(da, si);
 			}
+
+			if (auto st = argval.param->byval_struct) {
+				PlnStructArg &sarg = struct_args[j];
+				PlnVariable* svar;
+				if (sarg.clone) {
+					sarg.clone->finishCopy(da, si);
+					svar = sarg.clone->var;
+				} else if (sarg.var) {
+					da.popSrc(sarg.var->place);
+					svar = sarg.var;
+				} else {
+					svar = v.inf.var;
+				}
+
+				for (auto eb: st->eightbytes) {
+					auto part_ex = new PlnStructMember(new PlnExpression(svar), eb);
+					part_ex->data_places.push_back(arg_dps[dp_i]);
+					part_ex->finish(da, si);
+					sarg.part_exs.push_back(part_ex);
+					dp_i++;
+				}
+
+				if (sarg.var && !sarg.free_ex)
+					da.releaseDp(sarg.var->place);
+			}
 			++j;
 		}
 	}
@@ -200,10 +276,34 @@ static vector<PlnDataPlace*> loadArgs(PlnFunctionCall *fcall, PlnDataAllocator&
 	return arg_dps;
 }
 
+static void finishStructArgFree(vector<PlnStructArg> &struct_args, PlnDataAllocator& da, PlnScopeInfo& si)
+{
+	for (auto &sarg: struct_args) {
+		if (sarg.clone) {
+			sarg.clone->finishFree(da, si);
+		} else if (sarg.free_ex) {
+			sarg.free_ex->finish(da, si);
+			da.releaseDp(sarg.var->place);
+		}
+	}
+}
+
 void PlnFunctionCall::finish(PlnDataAllocator& da, PlnScopeInfo& si)
 {
 	int func_type = function->type;
 
+	if (function->byval_ret_struct) {
+		// Allocate the object before the call to store returned registers directly.
+		PlnVarType* t = function->return_vals[0].var_type;
+		ret_struct_var = PlnVariable::createTempVar(da, t, "(ret struct)");
+		vector<PlnExpression*> args;
+		t->getAllocArgs(args);
+		ret_alloc_ex = t->getAllocEx(args);
+		ret_alloc_ex->data_places.push_back(ret_struct_var->place);
+		ret_alloc_ex->finish(da, si);
+		da.popSrc(ret_struct_var->place);
+	}
+
 	if (arguments.size()) 
 		arg_dps = loadArgs(this, da, si);
 
@@ -213,11 +313,17 @@ void PlnFunctionCall::finish(PlnDataAllocator& da, PlnScopeInfo& si)
 	for (auto free_work_var: free_work_vars)
 		da.popSrc(free_work_var->place);
 
-	da.funcCalled(arg_dps, func_type, function->never_return);
+	da.funcCalled(arg_dps, func_type, function->never_return,
+			function->has_destroy_regs ? &function->destroy_regs : NULL);
 
 	ret_dps = function->createRetValDps();
 	da.setRetValDps(function->type, ret_dps, false);
 
+	if (function->byval_ret_struct) {
+		finishRetStruct(da, si);
+		return;
+	}
+
 	int i = 0;
 	for (auto r: function->return_vals) {
 		ret_dps[i]->data_type = r.local_var->var_type->data_type();
@@ -253,6 +359,8 @@ void PlnFunctionCall::finish(PlnDataAllocator& da, PlnScopeInfo& si)
 	for (auto free_ex: free_exs)
 		free_ex->finish(da, si);
 
+	finishStructArgFree(struct_args, da, si);
+
 	for (auto free_work_var: free_work_vars)
 		da.releaseDp(free_work_var->place);
 
@@ -261,6 +369,62 @@ void PlnFunctionCall::finish(PlnDataAllocator& da, PlnScopeInfo& si)
 
 }
 
+static void genStructArgAlloc(PlnStructArg &sarg, PlnGenerator &g)
+{
+	if (sarg.clone)
+		sarg.clone->genAlloc(g);
+}
+
+static void genStructArgParts(PlnStructArg &sarg, PlnGenerator &g)
+{
+	if (sarg.clone)
+		sarg.clone->genCopy(g);
+	else if (sarg.var)
+		g.genLoadDp(sarg.var->place);
+
+	for (auto part_ex: sarg.part_exs)
+		part_ex->gen(g);
+}
+
+static void genStructArgFree(vector<PlnStructArg> &struct_args, PlnGenerator &g)
+{
+	for (auto &sarg: struct_args) {
+		if (sarg.clone)
+			sarg.clone->genFree(g);
+		else if (sarg.free_ex)
+			sarg.free_ex->gen(g);
+	}
+}
+
+void PlnFunctionCall::finishRetStruct(PlnDataAllocator& da, PlnScopeInfo& si)
+{
+	for (auto dp: ret_dps)
+		da.allocDp(dp);
+
+	int i = 0;
+	for (auto eb: function->byval_ret_struct->eightbytes) {
+		auto part_ex = new PlnStructMember(new PlnExpression(ret_struct_var), eb);
+		auto part_dp = part_ex->values[0].getDataPlace(da);
+		da.pushSrc(part_dp, ret_dps[i]);
+		part_ex->finish(da, si);
+		da.popSrc(part_dp);
+		da.releaseDp(part_dp);
+		ret_part_exs.push_back(part_ex);
+		i++;
+	}
+
+	if (data_places.size()) {
+		da.pushSrc(data_places[0], ret_struct_var->place);
+
+	} else {
+		ret_free_ex = ret_struct_var->getFreeEx();
+		ret_free_ex->finish(da, si);
+		da.releaseDp(ret_struct_var->place);
+	}
+
+	finishStructArgFree(struct_args, da, si);
+}
+
 void PlnFunctionCall::gen(PlnGenerator &g)
 {
 	function->call_count++;
@@ -270,11 +434,13 @@ void PlnFunctionCall::gen(PlnGenerator &g)
 			int i=0;
 			for (auto arg: arguments) {
 				if (clones[i]) clones[i]->genAlloc(g);
+				genStructArgAlloc(struct_args[i], g);
 				arg.exp->gen(g);
 				if (clones[i]) {
 					clones[i]->genCopy(g);
 					clones[i]->gen(g);
 				}
+				genStructArgParts(struct_args[i], g);
 				i++;
 			}
 
@@ -303,6 +469,8 @@ void PlnFunctionCall::gen(PlnGenerator &g)
 			for (auto free_ex: free_exs)
 				free_ex->gen(g);
 
+			genStructArgFree(struct_args, g);
+
 			break;
 		}
 		case FT_SYS:
@@ -322,14 +490,21 @@ void PlnFunctionCall::gen(PlnGenerator &g)
 		}
 		case FT_C:
 		{
+			if (ret_alloc_ex) {
+				ret_alloc_ex->gen(g);
+				g.genLoadDp(ret_struct_var->place);
+			}
+
 			int i=0;
 			for (auto arg: arguments) {
 				if (clones[i]) clones[i]->genAlloc(g);
+				genStructArgAlloc(struct_args[i], g);
 				arg.exp->gen(g);
 				if (clones[i]) {
 					clones[i]->genCopy(g);
 					clones[i]->gen(g);
 				}
+				genStructArgParts(struct_args[i], g);
 				i++;
 			}
 
@@ -345,9 +520,19 @@ void PlnFunctionCall::gen(PlnGenerator &g)
 
 			g.genCCall(function->asm_name, arg_dtypes, function->has_va_arg);
 
+			for (auto part_ex: ret_part_exs) {
+				part_ex->gen(g);
+				g.genLoadDp(part_ex->values[0].inf.var->place);
+			}
+
 			for (auto dp: data_places) 
 				g.genSaveSrc(dp);
 
+			if (ret_free_ex)
+				ret_free_ex->gen(g);
+
+			genStructArgFree(struct_args, g);
+
 			break;
 		}
 		default:
@@ -376,6 +561,13 @@ static void initInternalFunctions()
 	f->addParam("status", PlnVarType::getSint(), PIO_INPUT, FPM_IN_BYVAL, NULL);
 	f->never_return = true;
 	internalFuncs[IFUNC_EXIT] = f;
+
+	f = new PlnFunction(FT_C, "__memcpy");
+	f->asm_name = "memcpy";
+	f->addParam("dst", PlnVarType::getObject(), PIO_INPUT, FPM_IN_BYREF, NULL);
+	f->addParam("src", PlnVarType::getObject(), PIO_INPUT, FPM_IN_BYREF, NULL);
+	f->addParam("n", PlnVarType::getUint(), PIO_INPUT, FPM_IN_BYVAL, NULL);
+	internalFuncs[IFUNC_MEMCPY] = f;
 }
 
 PlnFunction* PlnFunctionCall::getInternalFunc(PlnInternalFuncType func_type)
@@ -9,6 +9,7 @@ enum PlnInternalFuncType {
 	IFUNC_MALLOC,
 	IFUNC_FREE,
 	IFUNC_EXIT,
+	IFUNC_MEMCPY,
 	IFUNC_NUM
 };
 
@@ -44,6 +45,15 @@ public:
 	}
 };
 
+// Small struct argument passed by value in registers.
+class PlnStructArg {
+public:
+	PlnVariable* var = NULL;	// Temporary pointer to the struct value.
+	PlnClone* clone = NULL;	// Copy of the struct value that built by items.
+	PlnExpression* free_ex = NULL;	// Free the work object after call.
+	vector<PlnExpression*> part_exs;
+};
+
 // FunctionCall: Function Arguments;
 class PlnFunctionCall : public PlnExpression
 {
@@ -58,6 +68,11 @@ public:
 	vector<PlnVariable*> free_vars;
 	vector<PlnExpression*> free_exs;
 	vector<PlnClone*> clones;
+	vector<PlnStructArg> struct_args;
+	PlnVariable* ret_struct_var;	// Heap object to store the struct returned in registers.
+	PlnExpression* ret_alloc_ex;
+	PlnExpression* ret_free_ex;
+	vector<PlnExpression*> ret_part_exs;
 
 	PlnFunctionCall(PlnFunction* f);
 	PlnFunctionCall(PlnFunction* f, vector<PlnArgument> &args);
@@ -66,6 +81,7 @@ public:
 
 	void finish(PlnDataAllocator& da, PlnScopeInfo& si) override;
 	void gen(PlnGenerator& g) override;
+	void finishRetStruct(PlnDataAllocator& da, PlnScopeInfo& si);
 
 	static PlnFunction* getInternalFunc(PlnInternalFuncType func_type);
 };
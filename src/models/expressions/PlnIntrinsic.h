@@ -0,0 +1,215 @@
+/// PlnIntrinsic Expression model class declaration.
+///
+/// Process the well-known C function inline instead of calling it.
+/// The registers are not destroyed unlike function call.
+/// e.g.) ccall sqrtf(flo32 x) -> flo32; sqrtf(a) => sqrtss
+/// Also process the builtin bit operations that has no declaration.
+/// e.g.) popcount(a) => popcnt
+///
+/// @file	PlnIntrinsic.h
+/// @copyright	2022 YAMAGUCHI Toshinobu
+
+#include "../PlnExpression.h"
+
+class PlnIntrinsic : public PlnExpression {
+public:
+	int intrinsic;
+	int size;	// operand size of bit operation.
+	vector<PlnExpression*> args;
+	PlnDataPlace *dp, *second_dp;
+	bool is_second_temp;
+
+	PlnIntrinsic(int intrinsic, vector<PlnExpression*> &args, PlnVarType* ret_type, int size=0)
+		: intrinsic(intrinsic), size(size), args(args), dp(NULL), second_dp(NULL),
+		  is_second_temp(false), PlnExpression(ET_INTRINSIC)
+	{
+		BOOST_ASSERT(args.size() == 1 || args.size() == 2);
+		PlnValue val;
+		val.type = VL_WORK;
+		val.inf.wk_type = ret_type;
+		values.push_back(val);
+	}
+
+	~PlnIntrinsic() {
+		for (auto a: args)
+			delete a;
+	}
+
+	// Return NULL when the function is not intrinsic.
+	static PlnExpression* create(PlnFunction* f, vector<PlnArgument> &args, bool has_round_insn) {
+		static const struct {
+			const char* name;
+			int intrinsic;
+			int data_type;
+			int size;
+			int arg_num;
+		} intrinsics[] = {
+			{ "sqrt", IN_SQRT, DT_FLOAT, 8, 1 }, { "sqrtf", IN_SQRT, DT_FLOAT, 4, 1 },
+			{ "fabs", IN_FABS, DT_FLOAT, 8, 1 }, { "fabsf", IN_FABS, DT_FLOAT, 4, 1 },
+			{ "fmin", IN_FMIN, DT_FLOAT, 8, 2 }, { "fminf", IN_FMIN, DT_FLOAT, 4, 2 },
+			{ "fmax", IN_FMAX, DT_FLOAT, 8, 2 }, { "fmaxf", IN_FMAX, DT_FLOAT, 4, 2 },
+			{ "floor", IN_FLOOR, DT_FLOAT, 8, 1 }, { "floorf", IN_FLOOR, DT_FLOAT, 4, 1 },
+			{ "ceil", IN_CEIL, DT_FLOAT, 8, 1 }, { "ceilf", IN_CEIL, DT_FLOAT, 4, 1 },
+		};
+
+		if (f->type != FT_C || f->has_va_arg)
+			return NULL;
+
+		for (auto &in: intrinsics) {
+			if (f->name != in.name)
+				continue;
+			if ((in.intrinsic == IN_FLOOR || in.intrinsic == IN_CEIL) && !has_round_insn)
+				return NULL;
+
+			// Signature should be same as C library.
+			if (f->parameters.size() != in.arg_num || f->return_vals.size() != 1)
+				return NULL;
+			for (auto p: f->parameters) {
+				PlnVarType* t = p->var->var_type;
+				if (p->passby != FPM_IN_BYVAL || t->data_type() != in.data_type || t->size() != in.size)
+					return NULL;
+			}
+			PlnVarType* ret_type = f->return_vals[0].var_type;
+			if (ret_type->data_type() != in.data_type || ret_type->size() != in.size)
+				return NULL;
+
+			if (args.size() != in.arg_num)
+				return NULL;
+			vector<PlnExpression*> exps;
+			for (auto &arg: args) {
+				BOOST_ASSERT(arg.exp && arg.inf.size() == 1);
+				if (arg.inf[0].iomode != PIO_INPUT || arg.inf[0].opt != AG_NONE)
+					return NULL;
+				exps.push_back(arg.exp);
+			}
+
+			return new PlnIntrinsic(in.intrinsic, exps, ret_type);
+		}
+
+		return NULL;
+	}
+
+	// Return NULL when the name is not builtin.
+	static PlnExpression* createBuiltin(const string& name, vector<PlnArgument> &args) {
+		static const struct {
+			const char* name;
+			int intrinsic;
+			int arg_num;
+		} builtins[] = {
+			{ "popcount", IN_POPCOUNT, 1 }, { "clz", IN_CLZ, 1 }, { "ctz", IN_CTZ, 1 },
+			{ "bswap", IN_BSWAP, 1 }, { "rotl", IN_ROTL, 2 }, { "rotr", IN_ROTR, 2 },
+		};
+
+		for (auto &bi: builtins) {
+			if (name != bi.name)
+				continue;
+			if (args.size() != bi.arg_num)
+				return NULL;
+
+			vector<PlnExpression*> exps;
+			for (auto &arg: args) {
+				if (!arg.exp || arg.inf.size() != 1 || arg.exp->values.size() != 1)
+					return NULL;
+				if (arg.inf[0].iomode != PIO_INPUT || arg.inf[0].opt != AG_NONE)
+					return NULL;
+				int dt = arg.exp->getDataType();
+				if (dt != DT_SINT && dt != DT_UINT)
+					return NULL;
+				exps.push_back(arg.exp);
+			}
+
+			// Operate on the width of the first argument.
+			PlnVarType* t = exps[0]->values[0].getVarType();
+			int size = t->size();
+			PlnVarType* ret_type = PlnVarType::getSint();
+			if ((bi.intrinsic == IN_BSWAP || bi.intrinsic == IN_ROTL || bi.intrinsic == IN_ROTR)
+					&& t->data_type() == DT_UINT)
+				ret_type = PlnVarType::getUint();
+
+			return new PlnIntrinsic(bi.intrinsic, exps, ret_type, size);
+		}
+
+		return NULL;
+	}
+
+	void finish(PlnDataAllocator& da, PlnScopeInfo& si) override {
+		PlnVarType* t = values[0].getVarType();
+		if (args.size() == 2) {
+			// fmin/fmax is commutative. Keep the direct variable at second.
+			if ((intrinsic == IN_FMIN || intrinsic == IN_FMAX)
+					&& isDirectVar(args[0]) && !isDirectVar(args[1]))
+				std::swap(args[0], args[1]);
+
+			if (isDirectVar(args[1]) || isIntLiteral(args[1])) {
+				second_dp = args[1]->values[0].getDataPlace(da);
+			} else {
+				second_dp = da.prepareLocalVar(t->size(), args[1]->getDataType());
+				static string cmt="(temp@intrinsic)";
+				second_dp->comment = &cmt;
+				is_second_temp = true;
+			}
+			args[1]->data_places.push_back(second_dp);
+			args[1]->finish(da, si);
+			if (is_second_temp) da.popSrc(second_dp);
+		}
+
+		dp = da.prepareAccumulator(t->data_type(), t->size());
+		args[0]->data_places.push_back(dp);
+		args[0]->finish(da, si);
+
+		if (second_dp && !is_second_temp) da.popSrc(second_dp);
+		da.popSrc(dp);
+
+		PlnDataPlace* result = dp;
+		if (second_dp)
+			result = da.added(dp, second_dp);
+
+		if (data_places.size())
+			da.pushSrc(data_places[0], result);
+		else
+			da.releaseDp(result);
+	}
+
+	void gen(PlnGenerator& g) override {
+		static const char* names[] = { "sqrt", "fabs", "fmin", "fmax", "floor", "ceil",
+			"popcount", "clz", "ctz", "bswap", "rotl", "rotr" };
+		string cmt = string(names[intrinsic]) + "(" + dp->cmt();
+
+		unique_ptr<PlnGenEntity> se;
+		if (second_dp) {
+			args[1]->gen(g);
+			if (is_second_temp) g.genLoadDp(second_dp);
+		}
+		args[0]->gen(g);
+		if (second_dp) {
+			if (!is_second_temp) g.genLoadDp(second_dp);
+			se = g.getEntity(second_dp);
+			cmt += ", " + second_dp->cmt();
+		}
+		g.genLoadDp(dp);
+
+		auto e = g.getEntity(dp);
+		if (size)
+			g.genBitIntrinsic(intrinsic, size, e.get(), se.get(), cmt + ")");
+		else
+			g.genIntrinsic(intrinsic, e.get(), se.get(), cmt + ")");
+
+		if (data_places.size())
+			g.genSaveSrc(data_places[0]);
+	}
+
+private:
+	bool isDirectVar(PlnExpression* ex) {
+		PlnValue &v = ex->values[0];
+		if (ex->type != ET_VALUE || v.type != VL_VAR || v.inf.var->is_indirect)
+			return false;
+		if (size)	// rotate count: any integer
+			return true;
+		return v.getVarType()->data_type() == values[0].getVarType()->data_type()
+			&& v.getVarType()->size() == values[0].getVarType()->size();
+	}
+
+	bool isIntLiteral(PlnExpression* ex) {
+		return size && ex->type == ET_VALUE && (ex->values[0].type == VL_LIT_INT8 || ex->values[0].type == VL_LIT_UINT8);
+	}
+};
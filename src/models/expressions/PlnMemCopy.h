@@ -1,32 +1,56 @@
 /// PlnMemCopy Expression model class declaration.
 ///
+/// Copy the object that is trivially copyable (no heap member).
+/// Small object: unrolled moves, Middle: rep movs, Large: memcpy().
+///
 /// @file	PlnMemCopy.h
 /// @copyright	2018-2022 YAMAGUCHI Toshinobu 
 
 #include "../PlnExpression.h"
 
+enum {
+	MCPY_UNROLL_MAX = 256,	// Max size to copy by unrolled moves.
+	MCPY_CALL_MIN = 512	// Min size to copy by memcpy().
+};
+
 class PlnMemCopy : public PlnExpression {
 public:
 	PlnExpression *dst_ex, *src_ex, *len_ex;
 	PlnDataPlace *cp_dst_dp, *cp_src_dp, *cp_len_dp;
 	int cp_unit;
+	uint64_t cp_size;
 	PlnMemCopy(PlnExpression *dst, PlnExpression *src, PlnExpression *len)
 		: dst_ex(dst), src_ex(src), len_ex(len), cp_dst_dp(NULL), cp_src_dp(NULL), cp_len_dp(NULL),
-			cp_unit(1), PlnExpression(ET_MCOPY)
+			cp_unit(1), cp_size(0), PlnExpression(ET_MCOPY)
 	{ 
 		BOOST_ASSERT(dst && src && len);
 		BOOST_ASSERT(len_ex->type == ET_VALUE);
 		BOOST_ASSERT(len_ex->values[0].type == VL_LIT_UINT8);
 
-		uint64_t cp_size = len_ex->values[0].inf.uintValue;
-		if ((cp_size % 8) == 0) {
-			cp_size /= 8; cp_unit = 8;
-		} else if ((cp_size % 4) == 0) {
-			cp_size /= 4; cp_unit = 4;
-		} else if ((cp_size % 2) == 0) {
-			cp_size /= 2; cp_unit = 2;
+		cp_size = len_ex->values[0].inf.uintValue;
+		if (cp_size <= MCPY_UNROLL_MAX)
+			return;
+
+		uint64_t cp_num = cp_size;
+		if ((cp_num % 8) == 0) {
+			cp_num /= 8; cp_unit = 8;
+		} else if ((cp_num % 4) == 0) {
+			cp_num /= 4; cp_unit = 4;
+		} else if ((cp_num % 2) == 0) {
+			cp_num /= 2; cp_unit = 2;
 		}
-		len_ex->values[0].inf.uintValue = cp_size;
+		len_ex->values[0].inf.uintValue = cp_num;
+	}
+
+	// Note: PlnFunctionCall.h is required.
+	static PlnExpression* create(PlnExpression *dst, PlnExpression *src, PlnExpression *len) {
+		BOOST_ASSERT(len->type == ET_VALUE && len->values[0].type == VL_LIT_UINT8);
+		if (len->values[0].inf.uintValue >= MCPY_CALL_MIN) {
+			vector<PlnExpression*> args = { dst, src, len };
+			return new PlnFunctionCall(PlnFunctionCall::getInternalFunc(IFUNC_MEMCPY), args);
+		}
+
+		return new PlnMemCopy(dst, src, len);
 	}
 
 	~PlnMemCopy() {
@@ -54,15 +78,21 @@ public:
 	}
 
 	void gen(PlnGenerator& g) override {
+		static string cmt = "deep copy";
 		src_ex->gen(g);
 		dst_ex->gen(g);
-		len_ex->gen(g);
 
 		g.genLoadDp(cp_src_dp);
 		g.genLoadDp(cp_dst_dp);
-		g.genLoadDp(cp_len_dp);
 
-		static string cmt = "deep copy";
+		if (cp_size <= MCPY_UNROLL_MAX) {
+			// The length register is used as work.
+			g.genUnrolledMemCopy(cp_size, cmt);
+			return;
+		}
+
+		len_ex->gen(g);
+		g.genLoadDp(cp_len_dp);
 		g.genMemCopy(cp_unit, cmt);
 	}
 };
@@ -0,0 +1,59 @@
+/// PlnPtrTableInit Expression model class declaration.
+///
+/// Set up pointer tables of nested arrays allocated in one block.
+/// e.g.) [2][3]int32: | ptr x2 | int32 x3 | int32 x3 |
+///
+/// @file	PlnPtrTableInit.h
+/// @copyright	2022 YAMAGUCHI Toshinobu
+
+#include "../PlnExpression.h"
+
+class PlnPtrTableInit : public PlnExpression {
+public:
+	PlnExpression *arr_ex;
+	vector<std::pair<uint64_t, uint64_t>> tables;	// pointer num, item size
+	vector<int> jmp_ids;
+	PlnDataPlace *tbl_dp, *item_dp, *num_dp;
+
+	PlnPtrTableInit(PlnVariable *arr_var, vector<std::pair<uint64_t, uint64_t>> &tables)
+		: tables(tables), tbl_dp(NULL), item_dp(NULL), num_dp(NULL), PlnExpression(ET_PTRTABLE)
+	{
+		BOOST_ASSERT(arr_var && tables.size());
+		arr_ex = new PlnExpression(arr_var);
+	}
+
+	~PlnPtrTableInit() {
+		delete arr_ex;
+	}
+
+	void finish(PlnDataAllocator& da, PlnScopeInfo& si) override {
+		BOOST_ASSERT(si.scope[0].type == SC_MODULE);
+		PlnModule* m = si.scope[0].inf.module;
+		for (auto &t: tables)
+			jmp_ids.push_back(m->getJumpID());
+
+		// Use the same registers as memory copy. (%rdi, %rsi, %rcx)
+		da.prepareMemCopyDps(tbl_dp, item_dp, num_dp);
+
+		arr_ex->data_places.push_back(tbl_dp);
+		arr_ex->finish(da, si);
+
+		// The item pointer and the counter are set in the loop of each table.
+		da.pushSrc(item_dp, da.getLiteralIntDp(0));
+		da.pushSrc(num_dp, da.getLiteralIntDp(0));
+
+		da.popSrc(tbl_dp);
+		da.popSrc(item_dp);
+		da.popSrc(num_dp);
+		da.memCopyed(tbl_dp, item_dp, num_dp);
+	}
+
+	void gen(PlnGenerator& g) override {
+		arr_ex->gen(g);
+		g.genLoadDp(tbl_dp);
+
+		static string cmt = "ptr table";
+		for (int i=0; i<tables.size(); i++)
+			g.genPtrTableInit(tables[i].first, tables[i].second, jmp_ids[i], cmt);
+	}
+};
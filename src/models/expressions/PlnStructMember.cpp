@@ -19,30 +19,30 @@
 #include "../../PlnException.h"
 #include "../types/PlnFixedArrayType.h"
 
-PlnStructMember::PlnStructMember(PlnExpression* sturct_ex, string member_name)
-	: PlnExpression(ET_STRUCTMEMBER), struct_ex(sturct_ex), def(NULL)
+static PlnStructMemberDef* findMemberDef(PlnExpression* struct_ex, const string& member_name)
 {
 	BOOST_ASSERT(struct_ex->values.size() == 1);
 	PlnTypeInfo *t = struct_ex->values[0].getVarType()->typeinf;
 	if (t->type == TP_STRUCT) {
 		PlnStructTypeInfo *st = static_cast<PlnStructTypeInfo*>(t);
 		for (auto md: st->members) {
-			if (md->name == member_name) {
-				def = md;
-				break;
-			}
+			if (md->name == member_name)
+				return md;
 		}
+	}
 
-		if (!def) {
-			PlnCompileError err(E_NoMemberName, t->tname, member_name);
-			throw err;
-		}
+	PlnCompileError err(E_NoMemberName, t->tname, member_name);
+	throw err;
+}
 
-	} else {
-		PlnCompileError err(E_NoMemberName, t->tname, member_name);
-		throw err;
-	}
+PlnStructMember::PlnStructMember(PlnExpression* sturct_ex, string member_name)
+	: PlnStructMember(sturct_ex, findMemberDef(sturct_ex, member_name))
+{
+}
 
+PlnStructMember::PlnStructMember(PlnExpression* sturct_ex, PlnStructMemberDef* def)
+	: PlnExpression(ET_STRUCTMEMBER), struct_ex(sturct_ex), def(def)
+{
 	BOOST_ASSERT(struct_ex->values[0].type == VL_VAR);
 	auto var = new PlnVariable();
 	auto struct_var = struct_ex->values[0].inf.var;
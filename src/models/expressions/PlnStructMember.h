@@ -13,6 +13,7 @@ public:
 	PlnStructMemberDef* def;
 
 	PlnStructMember(PlnExpression* sturct_ex, string member_name);
+	PlnStructMember(PlnExpression* sturct_ex, PlnStructMemberDef* def);
 	~PlnStructMember();
 	
 	void finish(PlnDataAllocator& da, PlnScopeInfo& si) override;
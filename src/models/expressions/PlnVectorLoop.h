@@ -0,0 +1,106 @@
+/// PlnVectorLoop Expression model class declaration.
+///
+/// Process the array items of simple counted loop by packed instructions.
+/// Returns the index to continue by the original loop.
+/// e.g.) while i < n { a[i] * k + b[i] -> c[i]; i++; }
+///
+/// @file	PlnVectorLoop.h
+/// @copyright	2022 YAMAGUCHI Toshinobu
+
+#include "../PlnExpression.h"
+
+class PlnVectorLoop : public PlnExpression {
+public:
+	vector<PlnExpression*> args;	// index, limit, arrays and scalars(, total)
+	vector<PlnVecCode> codes;
+	int data_type, item_size;
+	int loop_id, end_id;
+	vector<PlnDataPlace*> arg_dps, ret_dps;
+
+	PlnVectorLoop(vector<PlnExpression*> &args, vector<PlnVecCode> &codes, int data_type, int item_size)
+		: args(args), codes(codes), data_type(data_type), item_size(item_size),
+		  loop_id(-1), end_id(-1), PlnExpression(ET_VECLOOP)
+	{
+		BOOST_ASSERT(args.size() >= 2 && codes.size());
+		PlnValue val;
+		val.type = VL_WORK;
+		val.inf.wk_type = args[0]->values[0].getVarType();
+		values.push_back(val);
+		if (codes.back().ope == VOP_SUM) {
+			val.inf.wk_type = args.back()->values[0].getVarType();
+			values.push_back(val);
+		}
+	}
+
+	~PlnVectorLoop() {
+		for (auto a: args)
+			delete a;
+	}
+
+	void finish(PlnDataAllocator& da, PlnScopeInfo& si) override {
+		BOOST_ASSERT(si.scope[0].type == SC_MODULE);
+		PlnModule* m = si.scope[0].inf.module;
+		loop_id = m->getJumpID();
+		end_id = m->getJumpID();
+
+		for (auto a: args) {
+			int dt = a->getDataType();
+			int size = 8;
+			if (dt == DT_OBJECT) dt = DT_OBJECT_REF;
+			else if (dt == DT_FLOAT) size = item_size;
+			PlnDataPlace* dp = new PlnDataPlace(size, dt);
+			dp->status = DS_READY_ASSIGN;
+			dp->data.bytes.parent_dp = NULL;
+			arg_dps.push_back(dp);
+		}
+		da.setArgDps(FT_C, arg_dps, false);
+
+		for (int i=0; i<args.size(); i++) {
+			if (args[i]->getDataType() == DT_OBJECT)
+				arg_dps[i]->load_address = true;
+			args[i]->data_places.push_back(arg_dps[i]);
+			args[i]->finish(da, si);
+		}
+
+		for (auto dp: arg_dps)
+			da.popSrc(dp);
+		da.funcCalled(arg_dps, FT_C, false);
+
+		for (auto &v: values) {
+			PlnDataPlace* dp = new PlnDataPlace(8, v.inf.wk_type->data_type());
+			dp->status = DS_READY_ASSIGN;
+			dp->data.bytes.parent_dp = NULL;
+			ret_dps.push_back(dp);
+		}
+		da.setRetValDps(FT_C, ret_dps, false);
+
+		for (int i=0; i<ret_dps.size(); i++) {
+			da.allocDp(ret_dps[i]);
+			if (i < data_places.size())
+				da.pushSrc(data_places[i], ret_dps[i]);
+			else
+				da.releaseDp(ret_dps[i]);
+		}
+	}
+
+	void gen(PlnGenerator& g) override {
+		for (auto a: args)
+			a->gen(g);
+
+		for (auto dp: arg_dps)
+			g.genLoadDp(dp, false);
+		for (auto dp: arg_dps)
+			g.genSaveDp(dp);
+
+		vector<unique_ptr<PlnGenEntity>> arg_ens, ret_ens;
+		for (auto dp: arg_dps)
+			arg_ens.push_back(g.getEntity(dp));
+		for (auto dp: ret_dps)
+			ret_ens.push_back(g.getEntity(dp));
+
+		g.genVectorLoop(codes, data_type, item_size, arg_ens, ret_ens, loop_id, end_id);
+
+		for (auto dp: data_places)
+			g.genSaveSrc(dp);
+	}
+};
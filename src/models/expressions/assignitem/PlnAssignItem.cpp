@@ -17,7 +17,6 @@
 #include "../../../PlnMessage.h"
 #include "../../../PlnException.h"
 #include "../PlnDivOperation.h"
-#include "../PlnMemCopy.h"
 #include "../PlnClone.h"
 #include "../PlnArrayValue.h"
 #include "../PlnArrayItem.h"
@@ -89,7 +88,8 @@ PlnAssignItem* PlnAssignItem::createAssignItem(PlnExpression* ex)
 		}
 	}
 
-	if (ex->type == ET_ADD || ex->type == ET_MUL || ex->type == ET_NEG
+	if (ex->type == ET_ADD || ex->type == ET_MUL || ex->type == ET_NEG || ex->type == ET_FMA
+			|| ex->type == ET_INTRINSIC
 			|| ex->type == ET_AND || ex->type == ET_OR || ex->type == ET_CMP) {
 		BOOST_ASSERT(ex->values.size() == 1);
 		PlnValue v = ex->values[0];
@@ -108,7 +108,7 @@ PlnAssignItem* PlnAssignItem::createAssignItem(PlnExpression* ex)
 			return new PlnAssignWorkValsItem(ex);
 	}
 
-	if (ex->type == ET_FUNCCALL || ex->type == ET_CHAINCALL) {
+	if (ex->type == ET_FUNCCALL || ex->type == ET_CHAINCALL || ex->type == ET_VECLOOP) {
 		return new PlnAssignWorkValsItem(ex);
 	}
 
@@ -110,6 +110,8 @@ public:
 			} else {
 				PlnDataPlace *dp = dst_ex->values[0].getDataPlace(da);
 				da.pushSrc(place, dp);
+				if (dp->data_type == DT_OBJECT)	// e.g.) $A b; a -> b -> c
+					place->load_address = true;
 			}
 		}
 	}
@@ -22,7 +22,9 @@
 #include "../PlnConditionalBranch.h"
 #include "../../PlnGenerator.h"
 #include "../../PlnDataAllocator.h"
+#include "../../PlnScopeStack.h"
 #include "../expressions/PlnMemCopy.h"
+#include "../expressions/PlnPtrTableInit.h"
 
 static PlnFunction* registerObjectArrayAllocFunc(string func_name, PlnFixedArrayTypeInfo* arr_typeinf, PlnBlock *block)
 {
@@ -338,6 +340,9 @@ PlnVarType* PlnFixedArrayTypeInfo::getVarType(const string& mode, vector<PlnExpr
 
 string PlnFixedArrayVarType::tname()
 {
+	if (decl_type)
+		return decl_type->tname();
+
 	string base_tname = PlnTypeInfo::getFixedArrayName(static_cast<PlnFixedArrayTypeInfo*>(typeinf)->item_type, sizes);
 
 	if (mode == "rir" || mode == "rmr") {
@@ -584,7 +589,7 @@ PlnExpression *PlnFixedArrayVarType::getCopyEx(PlnExpression* dst_var, PlnExpres
 	if (alloc_size == 0) return NULL;
 
 	if (!arr_typeinf->has_heap_member) {
-		return new PlnMemCopy(dst_var, src_var, new PlnExpression(alloc_size));
+		return PlnMemCopy::create(dst_var, src_var, new PlnExpression(alloc_size));
 	}
 
 	vector<PlnExpression*> copy_func_args = {src_var, dst_var};
@@ -592,3 +597,53 @@ PlnExpression *PlnFixedArrayVarType::getCopyEx(PlnExpression* dst_var, PlnExpres
 
 	return new PlnFunctionCall(arr_typeinf->copy_func, copy_func_args);
 }
+
+// Nested arrays of one block layout. Pointer tables are followed by leaf items.
+// e.g.) [2][3]int32: | ptr x2 | int32 x3 | int32 x3 |
+bool PlnFixedArrayVarType::getContiguousLayout(vector<std::pair<uint64_t, uint64_t>> &ptr_tables, uint64_t &alloc_size)
+{
+	auto block_size = [](PlnFixedArrayVarType* t) {
+		uint64_t sz = t->item_type()->size();
+		for (int s: t->sizes)
+			sz *= s;
+		return sz;
+	};
+
+	alloc_size = 0;
+	uint64_t num = 1;
+	PlnFixedArrayVarType* t = this;
+	while (true) {
+		if (!block_size(t))
+			return false;
+
+		PlnVarType* it = t->item_type();
+		auto next_t = dynamic_cast<PlnFixedArrayVarType*>(it);
+		if (next_t && it->mode[ALLOC_MD] == 'h') {
+			for (int s: t->sizes)
+				num *= s;
+			ptr_tables.push_back({num, block_size(next_t)});
+			alloc_size += num * 8;
+			t = next_t;
+			continue;
+		}
+
+		if (it->data_type() == DT_OBJECT_REF || it->data_type() == DT_OBJECT || it->has_heap_member())
+			return false;
+
+		alloc_size += num * block_size(t);
+		return ptr_tables.size() > 0;
+	}
+}
+
+PlnExpression* PlnFixedArrayVarType::getContiguousAllocEx(PlnVariable* var, PlnExpression* &ptr_init_ex)
+{
+	vector<std::pair<uint64_t, uint64_t>> ptr_tables;
+	uint64_t alloc_size;
+	bool result = getContiguousLayout(ptr_tables, alloc_size);
+	BOOST_ASSERT(result);
+
+	ptr_init_ex = new PlnPtrTableInit(var, ptr_tables);
+
+	vector<PlnExpression*> args = { new PlnExpression(alloc_size) };
+	return new PlnFunctionCall(PlnFunctionCall::getInternalFunc(IFUNC_MALLOC), args);
+}
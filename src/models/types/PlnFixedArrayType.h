@@ -44,4 +44,7 @@ public:
 	PlnExpression* getFreeEx(PlnExpression* free_var) override; 
 	PlnExpression* getInternalFreeEx(PlnExpression* free_var, vector<PlnExpression*> &args) override; 
 	PlnExpression* getCopyEx(PlnExpression* dst_var, PlnExpression* src_var, vector<PlnExpression*> &args) override;
+
+	bool getContiguousLayout(vector<std::pair<uint64_t, uint64_t>> &ptr_tables, uint64_t &alloc_size);
+	PlnExpression* getContiguousAllocEx(PlnVariable* var, PlnExpression* &ptr_init_ex);
 };
@@ -4,6 +4,7 @@
 /// @copyright	2019-2022 YAMAGUCHI Toshinobu 
 
 #include <boost/assert.hpp>
+#include <algorithm>
 #include "../../PlnModel.h"
 #include "../../PlnConstants.h"
 #include "../../PlnTreeBuildHelper.h"
@@ -18,9 +19,9 @@
 #include "../PlnConditionalBranch.h"
 #include "../expressions/PlnStructMember.h"
 #include "../expressions/PlnAssignment.h"
-#include "../expressions/PlnMemCopy.h"
 #include "../expressions/PlnArrayValue.h"
 #include "../expressions/PlnFunctionCall.h"
+#include "../expressions/PlnMemCopy.h"
 #include "PlnStructType.h"
 #include "PlnArrayValueType.h"
 #include "PlnFixedArrayType.h"
@@ -255,6 +256,47 @@ PlnStructTypeInfo::PlnStructTypeInfo(const string &name, vector<PlnStructMemberD
 	data_type = DT_OBJECT;
 	data_size = alloc_size;
 
+	// Classify each 8 bytes to pass by value in registers. (System V ABI)
+	// e.g.) {flo64 x, y} => xmm, xmm,  {int32 a, flo32 b, int64 c} => gpr, gpr
+	bool is_flat = data_size > 0 && data_size <= 16;
+	for (auto m: this->members) {
+		int dt = m->type->data_type();
+		if (dt != DT_SINT && dt != DT_UINT && dt != DT_FLOAT)
+			is_flat = false;
+	}
+
+	if (is_flat) {
+		for (int offset = 0; offset < data_size; offset += 8) {
+			int size = std::min(8, data_size - offset);
+			bool is_flo = true;
+			for (auto m: this->members)
+				if (m->offset >= offset && m->offset < offset+8 && m->type->data_type() != DT_FLOAT)
+					is_flo = false;
+
+			PlnVarType* part_type = NULL;
+			if (is_flo && size == 4) part_type = PlnVarType::getFlo32();
+			else if (is_flo && size == 8) part_type = PlnVarType::getFlo64();
+			else if (size == 1) part_type = PlnVarType::getByte();
+			else if (size == 8) part_type = PlnVarType::getUint();
+			else if (size == 2 || size == 4) {
+				for (auto t: PlnTypeInfo::getBasicTypes())
+					if (t->data_type == DT_UINT && t->data_size == size)
+						part_type = t->getVarType();
+			}
+
+			if (!part_type) {	// e.g.) size == 6
+				for (auto eb: eightbytes)
+					delete eb;
+				eightbytes.clear();
+				break;
+			}
+
+			auto eb = new PlnStructMemberDef(part_type, "(" + std::to_string(offset) + ")");
+			eb->offset = offset;
+			eightbytes.push_back(eb);
+		}
+	}
+
 	if (need_alloc_func) {
 		string fname = PlnBlock::generateFuncName("new", {this}, {});
 		alloc_func = createObjMemberStructAllocFunc(fname, this, parent);
@@ -284,6 +326,8 @@ PlnStructTypeInfo::~PlnStructTypeInfo()
 {
 	for (auto member: members)
 		delete member;
+	for (auto eb: eightbytes)
+		delete eb;
 }
 
 PlnTypeConvCap PlnStructTypeInfo::canCopyFrom(const string& mode, PlnVarType *src, PlnAsgnType copymode) {
@@ -380,7 +424,7 @@ PlnExpression *PlnStructVarType::getCopyEx(PlnExpression* dst_var, PlnExpression
 	PlnStructTypeInfo* typeinfo = static_cast<PlnStructTypeInfo*>(typeinf);
 
 	if (!typeinfo->has_heap_member) {
-		return new PlnMemCopy(dst_var, src_var, new PlnExpression(uint64_t(typeinfo->data_size)));
+		return PlnMemCopy::create(dst_var, src_var, new PlnExpression(uint64_t(typeinfo->data_size)));
 	}
 
 	vector<PlnExpression*> copy_func_args = {src_var, dst_var};
@@ -391,6 +435,9 @@ PlnExpression *PlnStructVarType::getCopyEx(PlnExpression* dst_var, PlnExpression
 
 string PlnStructVarType::tname()
 {
+	if (decl_type)
+		return decl_type->tname();
+
 	string base_tname = typeinf->tname;
 
 	if (mode == "rir" || mode == "rmr") {
@@ -403,7 +450,7 @@ string PlnStructVarType::tname()
 		return "#" + base_tname;
 
 	} else {
-		BOOST_ASSERT(mode == "wmh");
+		BOOST_ASSERT(mode == "wmh" || mode == "wms");	// wms: passed by value in registers.
 		return base_tname;
 	}
 }
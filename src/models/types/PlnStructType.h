@@ -15,6 +15,7 @@ public:
 class PlnStructTypeInfo : public PlnTypeInfo {
 public:
 	vector<PlnStructMemberDef*> members;
+	vector<PlnStructMemberDef*> eightbytes;	// Parts passed in registers. Empty if passed by memory.
 	bool has_heap_member;
 	PlnFunction* alloc_func;
 	PlnFunction* internal_alloc_func;
@@ -19,6 +19,8 @@
 #include "PlnConstants.h"
 #include "PlnMessage.h"
 #include "models/PlnModule.h"
+#include "models/PlnType.h"
+#include "models/PlnVariable.h"
 #include "generators/PlnX86_64DataAllocator.h"
 #include "generators/PlnX86_64Generator.h"
 #include "PlnModelTreeBuilder.h"
@@ -55,6 +57,13 @@ int main(int argc, char* argv[])
 	bool do_link = true;
 	bool do_exec = true;
 	bool rm_objs = true;
+	bool stack_alloc_report = false;
+	int stack_alloc_limit = -1;
+	bool pool_alloc = false;
+	bool pool_alloc_stats = false;
+	int cpu_features = CPUF_SSE2;
+	bool fp_contract = false;
+	bool omit_frame_pointer = false;
 
 	string out_file = "a.out";
 	vector<string> object_files;
@@ -71,13 +80,23 @@ int main(int argc, char* argv[])
 		("compile,c", PlnMessage::getHelp(H_Compile))
 		("output,o", po::value<string>(), PlnMessage::getHelp(H_Output))
 		("execute,x", PlnMessage::getHelp(H_Execute))
+		("stack-alloc-limit", po::value<int>(), PlnMessage::getHelp(H_StackAllocLimit))
+		("stack-alloc-report", PlnMessage::getHelp(H_StackAllocReport))
+		("pool-alloc", PlnMessage::getHelp(H_PoolAlloc))
+		("pool-alloc-stats", PlnMessage::getHelp(H_PoolAllocStats))
+		("march", po::value<string>(), PlnMessage::getHelp(H_March))
+		("fp-contract", po::value<string>(), PlnMessage::getHelp(H_FPContract))
+		("fomit-frame-pointer", PlnMessage::getHelp(H_OmitFramePointer))
 		("input-file", po::value<vector<string>>(), PlnMessage::getHelp(H_Input));
 
 	p_opt.add("input-file", -1);
 	
 	try {
+		// Accept -march=... as well as gcc.
 		po::store(po::command_line_parser(argc, argv)
-				.options(opt).positional(p_opt).run(), vm);
+				.options(opt).positional(p_opt)
+				.style(po::command_line_style::default_style | po::command_line_style::allow_long_disguise)
+				.run(), vm);
 
 	} catch (exception &e) {
 		string what = e.what();
@@ -151,6 +170,32 @@ int main(int argc, char* argv[])
 			rm_objs = false;
 		}
 		// else default (output & execute & out_file = "a.out")
+
+		if (vm.count("stack-alloc-limit"))
+			stack_alloc_limit = vm["stack-alloc-limit"].as<int>();
+		stack_alloc_report = vm.count("stack-alloc-report");
+		pool_alloc_stats = vm.count("pool-alloc-stats");
+		pool_alloc = vm.count("pool-alloc") || pool_alloc_stats;
+
+		if (vm.count("march")) {
+			string arch = vm["march"].as<string>();
+			cpu_features = PlnX86_64Generator::getCPUFeatures(arch);
+			if (cpu_features < 0) {
+				cerr << PlnMessage::getErr(E_CUI_UnknownArch, arch) << endl;
+				return PARAM_ERR;
+			}
+		}
+
+		if (vm.count("fp-contract")) {
+			string mode = vm["fp-contract"].as<string>();
+			if (mode != "fast" && mode != "off") {
+				cerr << PlnMessage::getErr(E_CUI_InvalidFPContract, mode) << endl;
+				return PARAM_ERR;
+			}
+			fp_contract = (mode == "fast");
+		}
+
+		omit_frame_pointer = vm.count("fomit-frame-pointer");
 	}
 
 	vector<string> files(vm["input-file"].as< vector<string> >());
@@ -212,7 +257,22 @@ int main(int argc, char* argv[])
 			try {
 				// Build palan model tree from AST.
 				PlnModelTreeBuilder modelTreeBuilder;
+				if (stack_alloc_limit >= 0)
+					modelTreeBuilder.stack_alloc_limit = stack_alloc_limit;
+				// FMA instructions are only available on the target that supports.
+				modelTreeBuilder.do_fp_contract = fp_contract && (cpu_features & CPUF_FMA);
+				modelTreeBuilder.has_round_insn = cpu_features & CPUF_SSE41;
 				PlnModule *module = modelTreeBuilder.buildModule(j["ast"]);
+				module->use_pool_alloc = pool_alloc;
+				module->pool_alloc_stats = pool_alloc_stats;
+
+				if (stack_alloc_report) {
+					for (PlnVariable* v: module->stack_alloc_vars) {
+						cerr << files[v->loc.fid] << ":" << v->loc.begin_line << ": "
+							<< "'" << v->name << "' is allocated on stack ("
+							<< v->var_type->size() << " bytes)" << endl;
+					}
+				}
 
 				// read libraries;
 				if (j["ast"]["libs"].is_array()) {
@@ -242,11 +302,15 @@ int main(int argc, char* argv[])
 
 				if (show_asm) {
 					PlnX86_64DataAllocator allocator;
+					allocator.use_rbp = omit_frame_pointer;
 					PlnX86_64Generator generator(cout);
+					generator.cpu_features = cpu_features;
+					generator.omit_frame_pointer = omit_frame_pointer;
 					module->gen(allocator, generator);
 
 				} else if (do_asm) {
 					PlnX86_64DataAllocator allocator;
+					allocator.use_rbp = omit_frame_pointer;
 					string obj_file = getDirName(fname) + getFileName(fname) + ".o";
 					string cmd = "as -o \"" + obj_file + "\"" ;
 
@@ -255,6 +319,8 @@ int main(int argc, char* argv[])
 					ostream as_input(&p_buf);
 
 					PlnX86_64Generator generator(as_input);
+					generator.cpu_features = cpu_features;
+					generator.omit_frame_pointer = omit_frame_pointer;
 					module->gen(allocator, generator);
 
 					int ret = getStatus(pclose(as));
@@ -41,14 +41,14 @@ void normalCaseTest()
 	testcode = "006_intarray";
 	REQUIRE(build(testcode) == "success");
 	REQUIRE(exec(testcode) == "3 2 4 5 9 3 4");
-	CHECK(mcheck("mtrace006") == "+27 -27");
+	CHECK(mcheck("mtrace006") == (disableOptimize ? "+27 -27" : "+15 -15"));
 
 	testcode = "007_whiletest";
 	REQUIRE(build(testcode) == "success");
 	REQUIRE(exec(testcode) == "0123456789321\n"
 								"012345 1245\n"
 								"012345 1245");
-	CHECK(mcheck("mtrace007") == "+20 -20");
+	CHECK(mcheck("mtrace007") == (disableOptimize ? "+20 -20" : "+0 -0"));
 
 	testcode = "008_iftest";
 	REQUIRE(build(testcode) == "success");
@@ -146,7 +146,7 @@ void normalCaseTest()
 	testcode = "018_floarr";
 	REQUIRE(build(testcode) == "success");
 	REQUIRE(exec(testcode) == "1.23 2.21 1.23 2.21");
-	CHECK(mcheck("mtrace018") == "+1 -1");
+	CHECK(mcheck("mtrace018") == (disableOptimize ? "+1 -1" : "+0 -0"));
 
 	testcode = "019_flocmp";
 	REQUIRE(build(testcode) == "success");
@@ -222,8 +222,8 @@ void normalCaseTest()
 	REQUIRE(build(testcode) == "success");
 	REQUIRE(exec(testcode) == "2 5 3 5 9 5 s234\n"
 						"2 2 1.23 2.34");
-	CHECK(mcheck("mtrace030-1") == "+15 -15");
-	CHECK(mcheck("mtrace030-2") == "+2 -2");
+	CHECK(mcheck("mtrace030-1") == (disableOptimize ? "+15 -15" : "+10 -10"));
+	CHECK(mcheck("mtrace030-2") == (disableOptimize ? "+2 -2" : "+1 -1"));
 
 	testcode = "031_regalloc";
 	REQUIRE(build(testcode) == "success");
@@ -266,6 +266,97 @@ void normalCaseTest()
 	REQUIRE(build(testcode) == "success");
 	REQUIRE(exec(testcode) == "3 4 0 99 9 99 88 4 22\n"
 							"4 4 9 Alice,Bob,12");
+
+	testcode = "040_divmagic";
+	REQUIRE(build(testcode) == "success");
+	REQUIRE(exec(testcode) == "0 -176366 -5 123456 -7 1234567890 123 0 154320 -7 -1234567 0");
+
+	testcode = "041_mulconst";
+	REQUIRE(build(testcode) == "success");
+	REQUIRE(exec(testcode) == "0 3 700 -7 0 168");
+
+	testcode = "042_branchless";
+	REQUIRE(build(testcode) == "success");
+	REQUIRE(exec(testcode) == "3 -3 5 -3 18446744073709551615 1 0 255 -1 100 3 -100 -20\n"
+							"1.5 1.5 2.5 2.5 1.5 2.5 -2.5 1.5 2.0 2 990");
+
+	testcode = "043_cmpbranch";
+	REQUIRE(build(testcode) == "success");
+	REQUIRE(exec(testcode) == "tftt tftf tttt tftt 5");
+
+	testcode = "044_looprotate";
+	REQUIRE(build(testcode) == "success");
+	REQUIRE(exec(testcode) == "25 5 120 4 6 12");
+
+	testcode = "045_stackalloc";
+	REQUIRE(build(testcode) == "success");
+	REQUIRE(exec(testcode) == "10 13 3 1.5 10 19 9 3 4");
+	CHECK(mcheck("mtrace045") == (disableOptimize ? "+11 -11" : "+5 -5"));
+
+	testcode = "046_automove";
+	REQUIRE(build(testcode) == "success");
+	REQUIRE(exec(testcode) == "2 101 6 7 10 10");
+	CHECK(mcheck("mtrace046") == (disableOptimize ? "+11 -11" : "+10 -10"));
+
+	testcode = "047_retstorage";
+	REQUIRE(build(testcode) == "success");
+	REQUIRE(exec(testcode) == "2 101 2 12 4 202 202 4 100");
+	CHECK(mcheck("mtrace047") == (disableOptimize ? "+18 -18" : "+9 -9"));
+
+	testcode = "048_contigarray";
+	REQUIRE(build(testcode) == "success");
+	REQUIRE(exec(testcode) == "12 138 23 154 23");
+	CHECK(mcheck("mtrace048") == (disableOptimize ? "+29 -29" : "+12 -12"));
+
+	testcode = "049_regionalloc";
+	REQUIRE(build(testcode) == "success");
+	REQUIRE(exec(testcode) == "0 1 4950 98 240");
+	CHECK(mcheck("mtrace049") == (disableOptimize ? "+8 -8" : "+7 -7"));
+
+	testcode = "050_memcopy";
+	REQUIRE(build(testcode) == "success");
+	REQUIRE(exec(testcode) == "1 2 3 58 99 207");
+
+	testcode = "051_rodatabind";
+	REQUIRE(build(testcode) == "success");
+	REQUIRE(exec(testcode) == "365 9 49 14 15");
+	CHECK(mcheck("mtrace051") == (disableOptimize ? "+8 -8" : "+5 -5"));
+
+	testcode = "052_vectorize";
+	REQUIRE(build(testcode) == "success");
+	REQUIRE(exec(testcode) == "1.5 11.5 21.5 0.0 -4.0 109 145 181 55 28 195 5");
+
+	testcode = "053_fma";
+	REQUIRE(build(testcode) == "success");
+	REQUIRE(exec(testcode) == "3.25 -2.50 5.50 11.00 25.0 6.750 1.000 0.000e+00");
+
+	testcode = "054_intrinsic";
+	REQUIRE(build(testcode) == "success");
+	REQUIRE(exec(testcode) == "1.50 1.50 7.0 0.0 0.2 1.0 -1.5 2.2 3.5 2.0 3.0 4.0 -2.0 2.0 -2.0 -1.0");
+
+	testcode = "055_bitops";
+	REQUIRE(build(testcode) == "success");
+	REQUIRE(exec(testcode) == "4 32 1 5 52 0 3 32 64 8 0 4 32 64 78563412 3412 -32768 34567812 81234567 45678123 56781234 128 -1152921504606846976");
+
+	testcode = "056_struct_byval";
+	REQUIRE(build(testcode) == "success");
+	REQUIRE(exec(testcode) == "25.0 2.0 61.0 11.0 18.0 2.0 4.0 6.0 111 100 7.5 8.5 1.5 2.5 2 3.0 105 122 131 5.0");
+
+	testcode = "057_fastcall";
+	REQUIRE(build(testcode) == "success");
+	REQUIRE(exec(testcode) == "14 25.0 140 10 13 16 392 6765 1 1 [2]96.0");
+
+	testcode = "058_tailcall";
+	REQUIRE(build(testcode) == "success");
+	REQUIRE(exec(testcode) == "500000500000 21 3628800.0 0 1 1");
+
+	testcode = "059_redzone";
+	REQUIRE(build(testcode) == "success");
+	REQUIRE(exec(testcode) == "800 3136 1944");
+
+	testcode = "060_shrinkwrap";
+	REQUIRE(build(testcode) == "success");
+	REQUIRE(exec(testcode) == "0 637");
 }
 
 TEST_CASE("Normal case with simple grammer", "[basic]")
@@ -276,7 +367,7 @@ TEST_CASE("Normal case with simple grammer", "[basic]")
 	normalCaseTest();
 }
 
-// Error file ID: 500-609
+// Error file ID: 500-610
 TEST_CASE("Compile error test", "[basic]")
 {
 	string testcode;
@@ -549,6 +640,9 @@ TEST_CASE("Compile error test", "[basic]")
 
 	testcode = "609_nosizearray_alloc_err";
 	REQUIRE(build(testcode) == "0:1-1 Can not allocate memory for [?,3]int32.");
+
+	testcode = "610_regionvar_err";
+	REQUIRE(build(testcode) == "0:3-3 Can not use the operator for '[100]int64'.");
 }
 
 TEST_CASE("Array description compile error test", "[basic]")
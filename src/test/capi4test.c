@@ -71,3 +71,38 @@ void tprintparray(int64_t** parray, int num1, int num2)
 	free(parray);
 }
 
+
+typedef struct {
+	double x;
+	double y;
+} TestVec2;
+
+typedef struct {
+	int id;
+	float rate;
+	int64_t count;
+} TestRec;
+
+double tvdot(TestVec2 a, TestVec2 b)
+{
+	return a.x*b.x + a.y*b.y;
+}
+
+TestVec2 tvmake(double x, double y)
+{
+	TestVec2 v = { x, y };
+	return v;
+}
+
+TestRec trecnext(TestRec r, int add)
+{
+	r.id++;
+	r.rate *= 2;
+	r.count += add;
+	return r;
+}
+
+int64_t trecsum(int64_t a, int64_t b, int64_t c, int64_t d, int64_t e, TestRec r, int64_t f)
+{
+	return a + b + c + d + e + r.id + (int64_t)r.rate + r.count + f;
+}
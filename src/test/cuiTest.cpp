@@ -13,10 +13,10 @@ TEST_CASE("CUI basic command-line test.", "[cui]")
 	REQUIRE(exec_pac("", "-h", "", "") == "success");
 	str = outstr("log");
 	split(strs, str, is_any_of("\n"));
-	REQUIRE(strs.size() == 20);
+	REQUIRE(strs.size() == 27);
 	REQUIRE(strs[0] == "Usage:");
 	REQUIRE(strs[8] == "Options:");
-	REQUIRE(strs[9] == "  -h [ --help ]         Display this help");
+	REQUIRE(strs[9] == "  -h [ --help ]           Display this help");
 	REQUIRE(errstr("log") == "");
 
 	// pac -v
@@ -82,6 +82,148 @@ TEST_CASE("CUI basic command-line test.", "[cui]")
 	REQUIRE(errstr(testcode) == "");
 	REQUIRE(outfile(testcode + ".o") == "exists");
 	REQUIRE(outfile(testcode) == "exists");
+
+	// pac -S <input-file> --stack-alloc-report
+	testcode = "045_stackalloc";
+	REQUIRE(exec_pac(testcode, "-S", "", "--stack-alloc-report") == "success");
+	str = errstr(testcode);
+	split(strs, str, is_any_of("\n"));
+	REQUIRE(strs.size() == 6);
+	REQUIRE(strs[0] == "045_stackalloc.pa:25: 'a' is allocated on stack (16 bytes)");
+
+	// pac -S <input-file> --stack-alloc-limit 8 --stack-alloc-report
+	REQUIRE(exec_pac(testcode, "-S", "", "--stack-alloc-limit 8 --stack-alloc-report") == "success");
+	REQUIRE(errstr(testcode) == "");
+
+	// pac <input-file> -o <output-file> -x --pool-alloc-stats
+	testcode = "024_default_arg";
+	REQUIRE(exec_pac(testcode, "-o", testcode, "-x --pool-alloc-stats") == "success");
+	REQUIRE(outstr(testcode) == "i34i12i32i13i12\n"
+								"i32i34i13i34\n"
+								"a22.2a42.2a24.4a44.4a5\n"
+								"i32a42.2");
+	REQUIRE(errstr(testcode) == "alloc: 11, free: 11, pool hit: 8\n");
+
+	// pac <input-file> -o <output-file> -x --pool-alloc
+	testcode = "048_contigarray";
+	REQUIRE(exec_pac(testcode, "-o", testcode, "-x --pool-alloc") == "success");
+	REQUIRE(outstr(testcode) == "12 138 23 154 23");
+	REQUIRE(errstr(testcode) == "");
+
+	testcode = "102_lsm";
+	REQUIRE(exec_pac(testcode, "-o", testcode, "-x --pool-alloc") == "success");
+	REQUIRE(outstr(testcode) == "-0.633, 1.204\n");
+	REQUIRE(errstr(testcode) == "");
+
+	// pac -S <input-file> -march=x86-64-v3
+	testcode = "052_vectorize";
+	REQUIRE(exec_pac(testcode, "-S", "", "-march=x86-64-v3") == "success");
+	str = outstr(testcode);
+	REQUIRE(str.find("vmulps %ymm0, %ymm8, %ymm8") != string::npos);
+	REQUIRE(str.find("\tmulss") == string::npos);
+	REQUIRE(str.find("\tvpxor %xmm15, %xmm15, %xmm15") != string::npos);
+	REQUIRE(str.find("\tpxor") == string::npos);
+	REQUIRE(errstr(testcode) == "");
+
+	// pac -S <input-file> -march=x86-64-v3 --fp-contract=fast
+	testcode = "053_fma";
+	REQUIRE(exec_pac(testcode, "-S", "", "-march=x86-64-v3 --fp-contract=fast") == "success");
+	str = outstr(testcode);
+	REQUIRE(str.find("vfmadd231sd %xmm1, %xmm11, %xmm0") != string::npos);
+	REQUIRE(str.find("vfmsub231sd") != string::npos);
+	REQUIRE(str.find("vfnmadd231ss") != string::npos);
+	REQUIRE(errstr(testcode) == "");
+
+	// Strict IEEE by default.
+	REQUIRE(exec_pac(testcode, "-S", "", "-march=x86-64-v3") == "success");
+	REQUIRE(outstr(testcode).find("vfmadd") == string::npos);
+
+	// pac <input-file> -o <output-file> -x -march=x86-64-v3 --fp-contract=fast
+	if (__builtin_cpu_supports("fma")) {
+		REQUIRE(exec_pac(testcode, "-o", testcode, "-x -march=x86-64-v3 --fp-contract=fast") == "success");
+		REQUIRE(outstr(testcode) == "3.25 -2.50 5.50 11.00 25.0 6.750 1.000 5.551e-17");
+	}
+
+	// pac -S <input-file> -march=x86-64-v2
+	testcode = "054_intrinsic";
+	REQUIRE(exec_pac(testcode, "-S", "", "-march=x86-64-v2") == "success");
+	str = outstr(testcode);
+	REQUIRE(str.find("\tsqrtss %xmm0, %xmm0") != string::npos);
+	REQUIRE(str.find("\troundsd $9, %xmm0, %xmm0") != string::npos);
+	REQUIRE(str.find("\troundss $10, %xmm0, %xmm0") != string::npos);
+	REQUIRE(str.find("call sqrt") == string::npos);
+	REQUIRE(str.find("call floor") == string::npos);
+	REQUIRE(errstr(testcode) == "");
+
+	// pac -S <input-file> -march=x86-64-v3
+	REQUIRE(exec_pac(testcode, "-S", "", "-march=x86-64-v3") == "success");
+	str = outstr(testcode);
+	REQUIRE(str.find("\tvsqrtss %xmm0, %xmm0, %xmm0") != string::npos);
+	REQUIRE(str.find("\tvroundsd $9, %xmm0, %xmm0, %xmm0") != string::npos);
+	REQUIRE(str.find("\tsqrtss") == string::npos);
+
+	// floor/ceil requires SSE4.1.
+	REQUIRE(exec_pac(testcode, "-S", "", "") == "success");
+	REQUIRE(outstr(testcode).find("call floor") != string::npos);
+
+	// pac -S <input-file> -march=x86-64-v3
+	testcode = "055_bitops";
+	REQUIRE(exec_pac(testcode, "-S", "", "-march=x86-64-v3") == "success");
+	str = outstr(testcode);
+	REQUIRE(str.find("\tpopcntq %rax, %rax") != string::npos);
+	REQUIRE(str.find("\tlzcntq %rax, %rax") != string::npos);
+	REQUIRE(str.find("\ttzcntq %rax, %rax") != string::npos);
+	REQUIRE(str.find("\trorxl $24, %eax, %eax") != string::npos);
+	REQUIRE(errstr(testcode) == "");
+
+	// Portable sequence without popcnt.
+	REQUIRE(exec_pac(testcode, "-S", "", "") == "success");
+	REQUIRE(outstr(testcode).find("popcnt") == string::npos);
+
+	// pac <input-file> -o <output-file> -x -march=x86-64-v3
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2")) {
+		REQUIRE(exec_pac(testcode, "-o", testcode, "-x -march=x86-64-v3") == "success");
+		REQUIRE(outstr(testcode) == "4 32 1 5 52 0 3 32 64 8 0 4 32 64 78563412 3412 -32768 34567812 81234567 45678123 56781234 128 -1152921504606846976");
+	}
+
+	// Calling convention of palan functions.
+	testcode = "057_fastcall";
+	REQUIRE(exec_pac(testcode, "-S", "", "") == "success");
+	str = outstr(testcode);
+	REQUIRE(str.find("\tmovq $7, %r10\t# $ -> arg") != string::npos);	// 7th argument
+	REQUIRE(str.find("\tmovq %rsi, %rdi\t# b -> arg") != string::npos);	// b is kept over sq().
+
+	// Tail recursion and tail call.
+	testcode = "058_tailcall";
+	REQUIRE(exec_pac(testcode, "-S", "", "") == "success");
+	str = outstr(testcode);
+	REQUIRE(str.find("\tjmp .L0\t# tail recursion") != string::npos);
+	REQUIRE(str.find("\tjmp isOdd.") != string::npos);
+
+	// Red zone of leaf function.
+	testcode = "059_redzone";
+	REQUIRE(exec_pac(testcode, "-S", "", "") == "success");
+	str = outstr(testcode);
+	REQUIRE(str.find("small.yec578dc44:\n\tpushq %rbp") == string::npos);
+	REQUIRE(str.find("\taddq -40(%rsp), %rax\t# %accm + v15") != string::npos);
+	REQUIRE(str.find("large.yec578dc44:\n\tpushq %rbp") != string::npos);	// over 128 bytes.
+
+	// pac -S <input-file> -fomit-frame-pointer
+	REQUIRE(exec_pac(testcode, "-S", "", "-fomit-frame-pointer") == "success");
+	str = outstr(testcode);
+	REQUIRE(str.find("pushq %rbp") == string::npos);
+	REQUIRE(str.find("large.yec578dc44:\n\tsubq $216, %rsp") != string::npos);
+	REQUIRE(str.find("\tmovq %rbp, (%rsp)\t# save reg") != string::npos);
+
+	REQUIRE(exec_pac(testcode, "-o", testcode, "-x -fomit-frame-pointer") == "success");
+	REQUIRE(outstr(testcode) == "800 3136 1944");
+
+	// Early return doesn't save the registers used only at the loop.
+	testcode = "060_shrinkwrap";
+	REQUIRE(exec_pac(testcode, "-S", "", "") == "success");
+	str = outstr(testcode);
+	REQUIRE(str.find("\tjg .L0\t# jump if cmp is false\n# {\n\tmovq $0, %rax") != string::npos);
+	REQUIRE(str.find(".L0:\t# end if\n\tmovq %rbx, -32(%rbp)\t# save reg") != string::npos);
 }
 
 TEST_CASE("CUI parametor validation test.", "[cui]")
@@ -150,6 +292,16 @@ TEST_CASE("CUI parametor validation test.", "[cui]")
 	REQUIRE(outstr(testcode) == "");
 	REQUIRE(errstr(testcode) == "Excecute option use only with output option\n");
 
+	// pac input -S --march=xxx
+	REQUIRE(exec_pac(testcode, "-S", "", "--march=i386") == "err: 255");
+	REQUIRE(outstr(testcode) == "");
+	REQUIRE(errstr(testcode) == "Unknown target architecture 'i386'\n");
+
+	// pac input -S --fp-contract=xxx
+	REQUIRE(exec_pac(testcode, "-S", "", "--fp-contract=on") == "err: 255");
+	REQUIRE(outstr(testcode) == "");
+	REQUIRE(errstr(testcode) == "Invalid fp-contract mode 'on'\n");
+
 	REQUIRE(outfile(testcode + ".o") == "not exists");
 	REQUIRE(outfile(testcode) == "not exists");
 }
@@ -194,4 +346,12 @@ TEST_CASE("sample code compile test.", "[cui]")
 	testcode = "raytracer";
 	REQUIRE(exec_pac(testcode, "-c", "", "", dir) == "success");
 	REQUIRE(outfile(testcode + ".o") == "exists");
+
+	testcode = "mulbench";
+	REQUIRE(exec_pac(testcode, "-c", "", "", dir) == "success");
+	REQUIRE(outfile(testcode + ".o") == "exists");
+
+	testcode = "copybench";
+	REQUIRE(exec_pac(testcode, "-c", "", "", dir) == "success");
+	REQUIRE(outfile(testcode + ".o") == "exists");
 }
@@ -65,6 +65,18 @@ string build(const string &srcf)
 			return loc.dump() + " " + err["msg"].get<string>();
 		}
 		PlnModelTreeBuilder modelTreeBuilder;
+		if (disableOptimize) {
+			modelTreeBuilder.stack_alloc_limit = 0;
+			modelTreeBuilder.do_auto_move = false;
+			modelTreeBuilder.do_ret_storage = false;
+			modelTreeBuilder.do_contiguous_alloc = false;
+			modelTreeBuilder.do_region_alloc = false;
+			modelTreeBuilder.do_rodata_bind = false;
+			modelTreeBuilder.do_vectorize = false;
+			modelTreeBuilder.do_intrinsic = false;
+			modelTreeBuilder.do_struct_byval = false;
+			modelTreeBuilder.do_tail_call = false;
+		}
 		try {
 			module = modelTreeBuilder.buildModule(j["ast"]);
 			module->do_opti_regalloc = !disableOptimize;